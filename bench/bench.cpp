@@ -0,0 +1,992 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "signals.hpp"
+#include "util/audio/fft_stage.hpp"
+#include "util/audio/fft_wisdom.hpp"
+#include "util/audio/bar_renderer.hpp"
+#include "util/audio/geometry.hpp"
+#include "util/audio/magnitude.hpp"
+#include "util/audio/spectrum_analyzer.hpp"
+#include "util/audio/wire_renderer.hpp"
+#include "util/histogram.hpp"
+#include "util/snapshot.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* Times every step of the analysis on its own, for a few signals, sample
+ * sizes, detail values and channel layouts. Results are written in google
+ * benchmark's json format, so its compare tools work on them */
+namespace bench {
+
+using audio::fft;
+using audio::fft_complex;
+using audio::fft_real;
+using audio::realv;
+
+static const uint32_t sample_rate = defaults::sample_rate;
+static const uint32_t sample_sizes[] = {512, 1024, defaults::sample_size, 2048, 4096};
+static const uint16_t details[] = {32, 128, 512};
+/* Smoothing on its own is swept much further, the references are O(n²) in
+ * the bar count, the replacements shouldn't be */
+static const uint16_t smoothing_details[] = {32, 64, 128, 256, 512, 1024, 2048, 4096};
+/* The magnitude kernel on its own goes further, up to what the fft sizes could grow to */
+static const uint32_t magnitude_sizes[] = {512, 1024, 2048, 4096, 8192, 16384};
+/* Consecutive buffers cut from each signal, iterations cycle through them */
+static const size_t frames = 32;
+static const uint64_t max_iterations = 1000000000;
+
+struct options {
+	double min_time = 0.05; /* Seconds per benchmark */
+	const char *filter = nullptr;
+	const char *pcm_path = nullptr;
+	const char *out_path = nullptr;
+	enum fft_rigor fft_rigor = defaults::fft_rigor;
+};
+
+/* Extra values of a benchmark, written next to the times like google benchmark's user counters */
+using counters = std::vector<std::pair<const char *, double>>;
+
+struct result {
+	std::string name;
+	uint64_t iterations;
+	double real_ns, cpu_ns; /* Per iteration */
+	counters extra;
+};
+
+/* Keeps the compiler from dropping work whose result isn't read */
+static inline void clobber()
+{
+#if defined(_MSC_VER)
+	_ReadWriteBarrier();
+#else
+	asm volatile("" ::: "memory");
+#endif
+}
+
+class runner {
+	options m_options;
+	std::vector<result> m_results;
+
+public:
+	explicit runner(const options &o) : m_options(o) {}
+
+	const options &opts() const { return m_options; }
+
+	bool selected(const std::string &name) const
+	{
+		return !m_options.filter || name.find(m_options.filter) != std::string::npos;
+	}
+
+	template<class F> void run(const std::string &name, F &&body, const counters &extra = {})
+	{
+		if (!selected(name))
+			return;
+
+		uint64_t iterations = 1;
+		for (;;) {
+			auto start = std::chrono::steady_clock::now();
+			auto cpu_start = std::clock();
+			for (uint64_t i = 0; i < iterations; i++) {
+				body(i);
+				clobber();
+			}
+			auto cpu = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+			auto real = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			if (real >= m_options.min_time || iterations >= max_iterations) {
+				m_results.push_back({name, iterations, real * 1e9 / iterations, cpu * 1e9 / iterations, extra});
+				std::fprintf(stderr, "%-72s %12.0f ns %12llu\n", name.c_str(), real * 1e9 / iterations,
+							 static_cast<unsigned long long>(iterations));
+				return;
+			}
+
+			/* Like google benchmark: aim 40% past the min time, grow at most 10x per round */
+			auto multiplier = real > 0 ? std::min(10.0, m_options.min_time * 1.4 / real) : 10.0;
+			iterations = std::max(iterations + 1, static_cast<uint64_t>(iterations * multiplier));
+		}
+	}
+
+	/* For benchmarks that time themselves, real_ns is the mean of what they measured */
+	void record(const std::string &name, uint64_t iterations, double real_ns, const counters &extra)
+	{
+		m_results.push_back({name, iterations, real_ns, real_ns, extra});
+		std::fprintf(stderr, "%-72s %12.0f ns %12llu\n", name.c_str(), real_ns,
+					 static_cast<unsigned long long>(iterations));
+	}
+
+	void write_json(FILE *out) const
+	{
+		char date[64];
+		auto now = std::time(nullptr);
+		std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+
+		std::fprintf(out, "{\n  \"context\": {\n");
+		std::fprintf(out, "    \"date\": \"%s\",\n", date);
+		std::fprintf(out, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+#if defined(NDEBUG)
+		std::fprintf(out, "    \"library_build_type\": \"release\",\n");
+#else
+		std::fprintf(out, "    \"library_build_type\": \"debug\",\n");
+#endif
+		std::fprintf(out, "    \"fft_precision\": \"%s\",\n", sizeof(fft_real) == sizeof(float) ? "float" : "double");
+		std::fprintf(out, "    \"pcm_kernel\": \"%s\",\n", audio::pcm_kernel_name());
+		std::fprintf(out, "    \"spectrum_kernel\": \"%s\",\n", audio::spectrum_kernel_name());
+		std::fprintf(out, "    \"sample_rate\": %u,\n", sample_rate);
+		std::fprintf(out, "    \"min_time\": %g\n  },\n  \"benchmarks\": [", m_options.min_time);
+
+		for (size_t i = 0; i < m_results.size(); i++) {
+			const auto &r = m_results[i];
+			std::fprintf(out,
+						 "%s\n    {\n      \"name\": \"%s\",\n      \"run_name\": \"%s\",\n"
+						 "      \"run_type\": \"iteration\",\n      \"iterations\": %llu,\n"
+						 "      \"real_time\": %.3f,\n      \"cpu_time\": %.3f,\n      \"time_unit\": \"ns\"",
+						 i ? "," : "", r.name.c_str(), r.name.c_str(), static_cast<unsigned long long>(r.iterations),
+						 r.real_ns, r.cpu_ns);
+			for (const auto &c : r.extra)
+				std::fprintf(out, ",\n      \"%s\": %g", c.first, c.second);
+			std::fprintf(out, "\n    }");
+		}
+		std::fprintf(out, "\n  ]\n}\n");
+	}
+};
+
+/* The cpu side of what libobs did for each bar before they were batched:
+ * gs_matrix_push/translate3f, then gs_draw_sprite filling and flushing the
+ * sprite's four vertices and uvs and multiplying the world matrix with the
+ * projection for the effect. Driver and gpu time aren't included */
+class sprite_emulation {
+	struct matrix4 {
+		float m[16];
+	};
+
+	std::vector<matrix4> m_stack = std::vector<matrix4>(1, identity());
+	matrix4 m_projection = identity(), m_view_projection = identity();
+	float m_sprite[16] = {};         /* Four vertices and their uvs */
+	float m_vertex_buffer[16] = {}; /* The mapped gpu buffer */
+
+	static matrix4 identity()
+	{
+		matrix4 m = {};
+		m.m[0] = m.m[5] = m.m[10] = m.m[15] = 1.f;
+		return m;
+	}
+
+	static void multiply(const matrix4 &a, const matrix4 &b, matrix4 *out)
+	{
+		for (int row = 0; row < 4; row++)
+			for (int col = 0; col < 4; col++)
+				out->m[row * 4 + col] = a.m[row * 4] * b.m[col] + a.m[row * 4 + 1] * b.m[4 + col] +
+										a.m[row * 4 + 2] * b.m[8 + col] + a.m[row * 4 + 3] * b.m[12 + col];
+	}
+
+public:
+	void draw(float x, float y, float width, float height)
+	{
+		/* gs_matrix_push() */
+		m_stack.push_back(m_stack.back());
+
+		/* gs_matrix_translate3f() */
+		auto translation = identity();
+		translation.m[12] = x;
+		translation.m[13] = y;
+		auto top = m_stack.back();
+		multiply(translation, top, &m_stack.back());
+
+		/* gs_draw_sprite() */
+		const float sprite[16] = {0.f, 0.f,    0.f, 0.f, width, 0.f,    1.f, 0.f,
+								  0.f, height, 0.f, 1.f, width, height, 1.f, 1.f};
+		std::memcpy(m_sprite, sprite, sizeof(sprite));
+		std::memcpy(m_vertex_buffer, m_sprite, sizeof(m_sprite));
+		multiply(m_stack.back(), m_projection, &m_view_projection);
+
+		/* gs_matrix_pop() */
+		m_stack.pop_back();
+	}
+};
+
+static std::string name_of(const char *stage, const signal &sig, uint32_t size, const char *variant)
+{
+	char name[256];
+	std::snprintf(name, sizeof(name), "%s/%s/size:%u/%s", stage, sig.name.c_str(), size, variant);
+	return name;
+}
+
+static std::string name_of(const char *stage, const signal &sig, uint32_t size, uint16_t detail, bool stereo)
+{
+	char name[256];
+	std::snprintf(name, sizeof(name), "%s/%s/size:%u/detail:%u/%s", stage, sig.name.c_str(), size, detail,
+				  stereo ? "stereo" : "mono");
+	return name;
+}
+
+/* Everything up to the magnitude spectrum, which only depends on the sample size */
+static void bench_transform(runner &r, const signal &sig, uint32_t size)
+{
+	const auto results = static_cast<size_t>(size) / 2 + 1;
+	const auto rigor = r.opts().fft_rigor;
+	auto offset = [size](uint64_t i) { return (i % frames) * size; };
+
+	auto *in = static_cast<fft_real *>(fft::malloc(sizeof(fft_real) * size * 2));
+	auto *out = static_cast<fft_complex *>(fft::malloc(sizeof(fft_complex) * results * 2));
+	auto *packed_out = static_cast<fft_complex *>(fft::malloc(sizeof(fft_complex) * size));
+	audio::pcm_stats stats_left, stats_right;
+
+	const struct {
+		audio::pcm_layout layout;
+		const char *name;
+	} layouts[] = {{audio::PL_MONO, "mono"}, {audio::PL_PLANAR, "stereo"}, {audio::PL_INTERLEAVED, "packed"}};
+
+	for (const auto &l : layouts) {
+		r.run(name_of("convert_pcm", sig, size, l.name), [&](uint64_t i) {
+			audio::convert_pcm(sig.left.data() + offset(i), sig.right.data() + offset(i), size, l.layout, in,
+							   in + size, &stats_left, &stats_right);
+		});
+		r.run(name_of("convert_pcm_scalar", sig, size, l.name), [&](uint64_t i) {
+			audio::convert_pcm_scalar(sig.left.data() + offset(i), sig.right.data() + offset(i), size, l.layout, in,
+									  in + size, &stats_left, &stats_right);
+		});
+	}
+
+	/* Plans are looked up like fft_stage does it, after waiting for the upgrade */
+	auto *cache = audio::wisdom::plan_cache();
+	auto plan_for = [&](uint32_t channels, bool packed) {
+		audio::fft_plan_key key;
+		key.sample_size = size;
+		key.in_alignment = fft::alignment_of(in);
+		key.out_alignment = fft::alignment_of(reinterpret_cast<fft_real *>(packed ? packed_out : out));
+		key.channels = channels;
+		key.packed = packed;
+		cache->prepare(key, rigor);
+		cache->wait();
+		return cache->get(key);
+	};
+
+	audio::convert_pcm(sig.left.data(), sig.right.data(), size, audio::PL_PLANAR, in, in + size, &stats_left,
+					   &stats_right);
+	for (uint32_t channels = 1; channels <= 2; channels++) {
+		auto plan = plan_for(channels, false);
+		if (plan)
+			r.run(name_of("fft", sig, size, channels == 2 ? "stereo" : "mono"),
+				  [&](uint64_t) { fft::execute(plan.get(), in, out); });
+	}
+
+	audio::convert_pcm(sig.left.data(), sig.right.data(), size, audio::PL_INTERLEAVED, in, in + size, &stats_left,
+					   &stats_right);
+	auto packed_plan = plan_for(2, true);
+	if (packed_plan)
+		r.run(name_of("fft", sig, size, "packed"), [&](uint64_t) {
+			fft::execute_c2c(packed_plan.get(), reinterpret_cast<fft_complex *>(in), packed_out);
+		});
+
+	const struct {
+		audio::spectrum_scale scale;
+		const char *name;
+	} scales[] = {{audio::SS_MAGNITUDE, "magnitude"}, {audio::SS_POWER, "power"}, {audio::SS_DECIBEL, "decibel"}};
+	realv magnitudes(results);
+
+	for (const auto &s : scales) {
+		r.run(name_of("compute_spectrum", sig, size, s.name),
+			  [&](uint64_t) { audio::compute_spectrum(out, results, s.scale, magnitudes.data()); });
+		r.run(name_of("compute_spectrum_scalar", sig, size, s.name),
+			  [&](uint64_t) { audio::compute_spectrum_scalar(out, results, s.scale, magnitudes.data()); });
+	}
+
+	fft::free(in);
+	fft::free(out);
+	fft::free(packed_out);
+
+	/* The whole transform as the visualizers run it */
+	for (const auto *variant : {"mono", "stereo", "packed"}) {
+		audio::fft_stage stage;
+		stage.configure(size, std::strcmp(variant, "mono") != 0, std::strcmp(variant, "packed") == 0, rigor);
+		cache->wait();
+		r.run(name_of("fft_stage", sig, size, variant),
+			  [&](uint64_t i) { stage.process(sig.left.data() + offset(i), sig.right.data() + offset(i)); });
+	}
+}
+
+/* Everything after the spectrum. Steps that change bars in place start
+ * from a copy each iteration, copy_bars is that copy on its own */
+static void bench_bars(runner &r, const signal &sig, uint32_t size, uint16_t detail, bool stereo,
+					   const std::vector<audio::spectrum> &spectra)
+{
+	const auto channels = stereo ? 2u : 1u;
+	audio::analysis_settings settings;
+	settings.sample_rate = sample_rate;
+	settings.sample_size = size;
+	settings.stereo = stereo;
+	settings.transform = false;
+	settings.detail = detail;
+
+	audio::spectrum_analyzer analyzer;
+	analyzer.configure(settings);
+
+	/* Raw bars of every frame and channel, the input of the later steps */
+	std::vector<realv> bars(frames * channels);
+	for (size_t f = 0; f < frames; f++) {
+		analyzer.generate_bars(spectra[f].left, &bars[f * channels]);
+		if (stereo)
+			analyzer.generate_bars(spectra[f].right, &bars[f * channels + 1]);
+	}
+
+	const auto number_of_bars = bars[0].size();
+	realv work[2];
+	for (auto &w : work)
+		w.reserve(number_of_bars);
+	auto frame_bars = [&](uint64_t i, uint32_t channel) -> const realv & {
+		return bars[(i % frames) * channels + channel];
+	};
+
+	r.run(name_of("generate_bars", sig, size, detail, stereo), [&](uint64_t i) {
+		const auto &spec = spectra[i % frames];
+		analyzer.generate_bars(spec.left, &work[0]);
+		if (stereo)
+			analyzer.generate_bars(spec.right, &work[1]);
+	});
+
+	r.run(name_of("copy_bars", sig, size, detail, stereo), [&](uint64_t i) {
+		for (uint32_t c = 0; c < channels; c++)
+			work[c] = frame_bars(i, c);
+	});
+
+	realv weights(number_of_bars);
+	for (size_t i = 0; i < number_of_bars; i++)
+		weights[i] = static_cast<fft_real>(std::pow(settings.mcat_smoothing_factor, i));
+	const auto min_height = static_cast<fft_real>(settings.bar_min_height);
+	audio::monstercat_scratch monstercat_scratch;
+	realv sgs_scratch;
+
+	r.run(name_of("smooth_monstercat", sig, size, detail, stereo), [&](uint64_t i) {
+		for (uint32_t c = 0; c < channels; c++) {
+			work[c] = frame_bars(i, c);
+			audio::monstercat_smooth(&work[c], weights, min_height, &monstercat_scratch);
+		}
+	});
+	r.run(name_of("smooth_monstercat_reference", sig, size, detail, stereo), [&](uint64_t i) {
+		for (uint32_t c = 0; c < channels; c++) {
+			work[c] = frame_bars(i, c);
+			audio::monstercat_smooth_reference(&work[c], weights, min_height);
+		}
+	});
+	r.run(name_of("smooth_sgs", sig, size, detail, stereo), [&](uint64_t i) {
+		for (uint32_t c = 0; c < channels; c++) {
+			work[c] = frame_bars(i, c);
+			audio::sgs_smooth(&work[c], settings.sgs_points, settings.sgs_passes, &sgs_scratch);
+		}
+	});
+	r.run(name_of("smooth_sgs_reference", sig, size, detail, stereo), [&](uint64_t i) {
+		for (uint32_t c = 0; c < channels; c++) {
+			work[c] = frame_bars(i, c);
+			audio::sgs_smooth_reference(&work[c], settings.sgs_points, settings.sgs_passes);
+		}
+	});
+
+	const auto height = static_cast<int32_t>(stereo ? settings.bar_height / 2 : settings.bar_height);
+	for (bool auto_scale : {true, false}) {
+		settings.use_auto_scale = auto_scale;
+		analyzer.configure(settings);
+		r.run(name_of(auto_scale ? "scale_bars_auto" : "scale_bars_fixed", sig, size, detail, stereo),
+			  [&](uint64_t i) {
+				  for (uint32_t c = 0; c < channels; c++) {
+					  work[c] = frame_bars(i, c);
+					  analyzer.scale_bars(height, &work[c]);
+				  }
+			  });
+	}
+	settings.use_auto_scale = defaults::use_auto_scale;
+
+	realv falloff[2];
+	r.run(name_of("apply_falloff", sig, size, detail, stereo), [&](uint64_t i) {
+		for (uint32_t c = 0; c < channels; c++)
+			analyzer.apply_falloff(frame_bars(i, c), &falloff[c]);
+	});
+
+	/* Render side: every bar into one vertex array for a single draw
+	 * per channel, against one sprite per bar like before */
+	const audio::bar_layout layout;
+	audio::vertexv vertices(audio::bar_vertex_count(number_of_bars) * channels);
+	r.run(name_of("bar_vertices", sig, size, detail, stereo), [&](uint64_t i) {
+		const auto &left = frame_bars(i, 0);
+		auto *out = vertices.data();
+		if (stereo) {
+			const auto &right = frame_bars(i, 1);
+			out += audio::build_bar_vertices(left.data(), left.size(), layout, CM_LEFT, out);
+			audio::build_bar_vertices(right.data(), right.size(), layout, CM_RIGHT, out);
+		} else {
+			audio::build_bar_vertices(left.data(), left.size(), layout, CM_BOTH, out);
+		}
+	});
+
+	sprite_emulation sprites;
+	r.run(name_of("bar_sprites_emulated", sig, size, detail, stereo), [&](uint64_t i) {
+		const float step = layout.bar_width + layout.bar_space;
+		const float offset = layout.stereo_space / 2, center = layout.bar_height / 2 + offset;
+		const auto &left = frame_bars(i, 0);
+		for (size_t bar = 0; bar + DEAD_BAR_OFFSET < left.size(); bar++) {
+			auto height_l = std::max<fft_real>(std::round(left[bar]), 1);
+			if (stereo) {
+				auto height_r = std::max<fft_real>(std::round(frame_bars(i, 1)[bar]), 1);
+				sprites.draw(bar * step, center - height_l - offset, layout.bar_width, height_l);
+				sprites.draw(bar * step, center + offset, layout.bar_width, height_r);
+			} else {
+				sprites.draw(bar * step, layout.bar_height - height_l, layout.bar_width, height_l);
+			}
+		}
+	});
+
+	/* Whole renderers on the recording backend, so vertex generation and the
+	 * recorded commands are timed. One frame's calls are saved as counters */
+	audio::render_recorder recorder;
+	auto render_counters = [&]() -> counters {
+		return {{"draw_calls", static_cast<double>(recorder.count(audio::RO_DRAW))},
+				{"vertices", static_cast<double>(recorder.vertices_drawn())},
+				{"buffers_created", static_cast<double>(recorder.count(audio::RO_CREATE))}};
+	};
+	const realv no_bars;
+	auto right_bars = [&](uint64_t i) -> const realv & { return stereo ? frame_bars(i, 1) : no_bars; };
+
+	audio::bar_layout bar_layout;
+	bar_layout.stereo = stereo;
+	audio::bar_renderer bar_renderer;
+	auto render_bars = [&](uint64_t i) {
+		recorder.clear();
+		bar_renderer.render(recorder, bar_layout, frame_bars(i, 0), right_bars(i));
+	};
+	/* The first frame makes the buffer, counters are of the second one */
+	render_bars(0);
+	render_bars(1);
+	r.run(name_of("render_bars", sig, size, detail, stereo), render_bars, render_counters());
+
+	const struct {
+		wire_mode mode;
+		const char *name;
+	} wire_modes[] = {{WM_THIN, "render_wire_thin"},
+					  {WM_THICK, "render_wire_thick"},
+					  {WM_FILL, "render_wire_fill"},
+					  {WM_FILL_INVERTED, "render_wire_fill_inverted"}};
+
+	for (const auto &m : wire_modes) {
+		audio::wire_layout wire_layout;
+		wire_layout.stereo = stereo;
+		wire_layout.wire_mode = m.mode;
+		audio::wire_renderer wire_renderer;
+		auto render_wire = [&](uint64_t i) {
+			recorder.clear();
+			wire_renderer.render(recorder, wire_layout, frame_bars(i, 0), right_bars(i));
+		};
+		render_wire(0);
+		render_wire(1);
+		r.run(name_of(m.name, sig, size, detail, stereo), render_wire, render_counters());
+	}
+
+	/* All of the above and gravity, like a visualizer's tick() */
+	const struct {
+		smooting_mode mode;
+		const char *name;
+	} modes[] = {{SM_NONE, "analyze_none"}, {SM_MONSTERCAT, "analyze_monstercat"}, {SM_SGS, "analyze_sgs"}};
+
+	for (const auto &m : modes) {
+		settings.smoothing = m.mode;
+		analyzer.configure(settings);
+		r.run(name_of(m.name, sig, size, detail, stereo), [&](uint64_t i) { analyzer.analyze(spectra[i % frames]); });
+	}
+}
+
+/* One mono frame from pcm to bars in one precision, independent of the one the
+ * build picked with SPECTRALIZER_FLOAT_FFT. Bars sum the magnitudes of
+ * logarithmically spaced bins, enough to compare the two precisions */
+template<class T> class precision_frame {
+	using api = audio::fft_api<T>;
+
+	uint32_t m_size;
+	size_t m_results;
+	T *m_in;
+	typename api::complex *m_out;
+	typename api::plan m_plan;
+	std::vector<T> m_bars;
+	std::vector<size_t> m_edges;
+
+public:
+	precision_frame(uint32_t size, uint16_t detail, unsigned flags)
+		: m_size(size),
+		  m_results(size / 2 + 1),
+		  m_in(static_cast<T *>(api::malloc(sizeof(T) * size))),
+		  m_out(static_cast<typename api::complex *>(api::malloc(sizeof(typename api::complex) * m_results))),
+		  m_bars(detail),
+		  m_edges(detail + 1)
+	{
+		{
+			std::lock_guard<std::mutex> lock(audio::planner_mutex());
+			m_plan = api::plan_r2c(static_cast<int>(size), m_in, m_out, flags);
+		}
+		for (size_t b = 0; b <= detail; b++)
+			m_edges[b] = std::min(m_results, static_cast<size_t>(std::pow(m_results, double(b) / detail)));
+	}
+
+	~precision_frame()
+	{
+		api::destroy(m_plan);
+		api::free(m_in);
+		api::free(m_out);
+	}
+
+	precision_frame(const precision_frame &) = delete;
+	precision_frame &operator=(const precision_frame &) = delete;
+
+	const std::vector<T> &run(const float *pcm)
+	{
+		for (uint32_t i = 0; i < m_size; i++)
+			m_in[i] = static_cast<T>(pcm[i] * constants::pcm_scale);
+		api::execute(m_plan, m_in, m_out);
+		for (size_t b = 0; b < m_bars.size(); b++) {
+			T sum = 0;
+			for (auto i = m_edges[b]; i < m_edges[b + 1]; i++)
+				sum += std::sqrt(m_out[i][0] * m_out[i][0] + m_out[i][1] * m_out[i][1]);
+			m_bars[b] = sum;
+		}
+		return m_bars;
+	}
+
+	/* What one channel's buffers take */
+	size_t bytes() const
+	{
+		return sizeof(T) * (m_size + m_bars.size()) + sizeof(typename api::complex) * m_results;
+	}
+};
+
+/* The same frames in float and double, whatever fft_real is, so the
+ * precision switch can be judged from one binary. The float entries carry
+ * how far their bars are from the double ones, relative to the largest bar */
+static void bench_precision(runner &r, const signal &sig)
+{
+	const auto rigor = r.opts().fft_rigor;
+	const unsigned flags = rigor == FR_ESTIMATE ? FFTW_ESTIMATE : rigor == FR_PATIENT ? FFTW_PATIENT : FFTW_MEASURE;
+	const uint16_t detail = defaults::detail;
+	char name[256];
+
+	for (auto size : sample_sizes) {
+		std::snprintf(name, sizeof(name), "precision_frame/%s/size:%u/double", sig.name.c_str(), size);
+		const std::string double_name = name;
+		std::snprintf(name, sizeof(name), "precision_frame/%s/size:%u/float", sig.name.c_str(), size);
+		const std::string float_name = name;
+		if (!r.selected(double_name) && !r.selected(float_name))
+			continue;
+
+		precision_frame<double> as_double(size, detail, flags);
+		precision_frame<float> as_float(size, detail, flags);
+		auto pcm = [&](uint64_t i) { return sig.left.data() + (i % frames) * size; };
+
+		double error = 0;
+		for (size_t f = 0; f < frames; f++) {
+			const auto &expected = as_double.run(pcm(f));
+			const auto &bars = as_float.run(pcm(f));
+			const auto largest = *std::max_element(expected.begin(), expected.end());
+			for (size_t b = 0; b < bars.size() && largest > 0; b++)
+				error = std::max(error, std::abs(bars[b] - expected[b]) / largest);
+		}
+
+		r.run(double_name, [&](uint64_t i) { as_double.run(pcm(i)); },
+			  {{"bytes", static_cast<double>(as_double.bytes())}});
+		r.run(float_name, [&](uint64_t i) { as_float.run(pcm(i)); },
+			  {{"bytes", static_cast<double>(as_float.bytes())}, {"max_error", error}});
+	}
+}
+
+/* compute_spectrum against its scalar reference on random bins,
+ * which is all it depends on */
+static void bench_magnitude(runner &r)
+{
+	const struct {
+		audio::spectrum_scale scale;
+		const char *name;
+	} scales[] = {{audio::SS_MAGNITUDE, "magnitude"}, {audio::SS_POWER, "power"}, {audio::SS_DECIBEL, "decibel"}};
+	std::mt19937 random(14);
+	std::uniform_real_distribution<fft_real> value(-1000, 1000);
+
+	for (auto size : magnitude_sizes) {
+		const auto results = static_cast<size_t>(size) / 2 + 1;
+		auto *in = static_cast<fft_complex *>(fft::malloc(sizeof(fft_complex) * results));
+		for (size_t i = 0; i < results; i++) {
+			in[i][0] = value(random);
+			in[i][1] = value(random);
+		}
+		realv out(results);
+
+		char name[256];
+		for (const auto &s : scales) {
+			std::snprintf(name, sizeof(name), "magnitude_kernel/size:%u/%s", size, s.name);
+			r.run(name, [&](uint64_t) { audio::compute_spectrum(in, results, s.scale, out.data()); });
+			std::snprintf(name, sizeof(name), "magnitude_kernel_scalar/size:%u/%s", size, s.name);
+			r.run(name, [&](uint64_t) { audio::compute_spectrum_scalar(in, results, s.scale, out.data()); });
+		}
+		fft::free(in);
+	}
+}
+
+/* Both smoothing modes and their references on synthetic bars, a falling
+ * spectrum with noise on top and some bars below the minimum height */
+static void bench_smoothing(runner &r)
+{
+	const audio::analysis_settings settings;
+	const auto min_height = static_cast<fft_real>(settings.bar_min_height);
+	const size_t frames = 8;
+	std::mt19937 random(15);
+	std::uniform_real_distribution<fft_real> noise(0.5, 1.5);
+
+	for (auto detail : smoothing_details) {
+		std::vector<realv> bars(frames, realv(detail));
+		for (auto &frame : bars) {
+			for (size_t i = 0; i < detail; i++)
+				frame[i] = i % 7 == 3 ? 0 : noise(random) * 5000 / (1 + i * 16 / static_cast<fft_real>(detail));
+		}
+		realv weights(detail);
+		for (size_t i = 0; i < detail; i++)
+			weights[i] = static_cast<fft_real>(std::pow(settings.mcat_smoothing_factor, i));
+		audio::monstercat_scratch monstercat_scratch;
+		realv work, sgs_scratch;
+		work.reserve(detail);
+		const counters extra = {{"bars", detail}};
+
+		char name[256];
+		auto named = [&](const char *what) {
+			std::snprintf(name, sizeof(name), "%s/detail:%u", what, detail);
+			return std::string(name);
+		};
+		r.run(
+			named("smoothing_monstercat"),
+			[&](uint64_t i) {
+				work = bars[i % frames];
+				audio::monstercat_smooth(&work, weights, min_height, &monstercat_scratch);
+			},
+			extra);
+		r.run(
+			named("smoothing_monstercat_reference"),
+			[&](uint64_t i) {
+				work = bars[i % frames];
+				audio::monstercat_smooth_reference(&work, weights, min_height);
+			},
+			extra);
+		r.run(
+			named("smoothing_sgs"),
+			[&](uint64_t i) {
+				work = bars[i % frames];
+				audio::sgs_smooth(&work, settings.sgs_points, settings.sgs_passes, &sgs_scratch);
+			},
+			extra);
+		r.run(
+			named("smoothing_sgs_reference"),
+			[&](uint64_t i) {
+				work = bars[i % frames];
+				audio::sgs_smooth_reference(&work, settings.sgs_points, settings.sgs_passes);
+			},
+			extra);
+	}
+}
+
+/* What applying new settings costs the thread that ticks, which is
+ * where update() work happens since settings are handed over as snapshots */
+static void bench_configure(runner &r)
+{
+	for (auto size : sample_sizes) {
+		for (auto detail : details) {
+			audio::analysis_settings settings;
+			settings.sample_rate = sample_rate;
+			settings.sample_size = size;
+			settings.stereo = true;
+			settings.detail = detail;
+			settings.fft_rigor = r.opts().fft_rigor;
+
+			audio::spectrum_analyzer analyzer;
+			analyzer.configure(settings);
+			audio::wisdom::plan_cache()->wait();
+
+			char name[256];
+			std::snprintf(name, sizeof(name), "configure_analyzer/size:%u/detail:%u/stereo", size, detail);
+			r.run(name, [&](uint64_t) { analyzer.configure(settings); });
+		}
+	}
+}
+
+/* Stand-in for source::config, about as large */
+struct handoff_settings {
+	uint64_t revision = 0;
+	double values[48] = {};
+};
+
+static uint64_t now_ns()
+{
+	return static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+			.count());
+}
+
+static void busy_wait(std::chrono::microseconds t)
+{
+	auto end = std::chrono::steady_clock::now() + t;
+	while (std::chrono::steady_clock::now() < end)
+		clobber();
+}
+
+/* Settings handoff under contention: update() publishes new settings every
+ * millisecond, the tick thread keeps them for 50us every 500us and the
+ * render thread for 200us every millisecond like it does while drawing.
+ * hold(thread, time) keeps the settings for that long and returns how long
+ * getting them took. The mean wait is the time, percentiles are counters */
+template<class Publish, class Hold>
+static void settings_handoff(runner &r, const char *mode, Publish &&publish, Hold &&hold)
+{
+	using std::chrono::microseconds;
+	const struct {
+		const char *name;
+		microseconds period, hold;
+	} threads[] = {{"tick", microseconds(500), microseconds(50)}, {"render", microseconds(1000), microseconds(200)}};
+	const size_t count = sizeof(threads) / sizeof(threads[0]);
+
+	std::string names[count];
+	bool any = false;
+	for (size_t i = 0; i < count; i++) {
+		names[i] = std::string("settings_handoff/") + mode + "/" + threads[i].name;
+		any = any || r.selected(names[i]);
+	}
+	if (!any)
+		return;
+
+	util::histogram waits[count];
+	std::atomic<bool> running{true};
+	std::vector<std::thread> workers;
+	workers.emplace_back([&]() {
+		while (running) {
+			publish();
+			std::this_thread::sleep_for(microseconds(1000));
+		}
+	});
+	for (size_t i = 0; i < count; i++) {
+		workers.emplace_back([&, i]() {
+			while (running) {
+				waits[i].add(hold(i, threads[i].hold));
+				std::this_thread::sleep_for(threads[i].period);
+			}
+		});
+	}
+
+	std::this_thread::sleep_for(std::chrono::duration<double>(std::max(r.opts().min_time * 10, 0.5)));
+	running = false;
+	for (auto &w : workers)
+		w.join();
+
+	for (size_t i = 0; i < count; i++) {
+		if (r.selected(names[i]))
+			r.record(names[i], waits[i].count(), waits[i].mean_us() * 1000,
+					 {{"wait_p50_ns", waits[i].percentile_us(0.5) * 1000},
+					  {"wait_p99_ns", waits[i].percentile_us(0.99) * 1000},
+					  {"wait_max_ns", waits[i].max_us() * 1000}});
+	}
+}
+
+/* The settings handoff before and after snapshots: one mutex that
+ * update(), tick and render all take, like value_mutex did */
+static void bench_settings_handoff(runner &r)
+{
+	std::mutex mutex;
+	handoff_settings settings;
+	settings_handoff(
+		r, "mutex",
+		[&]() {
+			std::lock_guard<std::mutex> lock(mutex);
+			settings.revision++;
+			for (auto &v : settings.values)
+				v += 1;
+		},
+		[&](size_t, std::chrono::microseconds hold) {
+			auto start = now_ns();
+			std::lock_guard<std::mutex> lock(mutex);
+			auto waited = now_ns() - start;
+			busy_wait(hold);
+			return waited;
+		});
+
+	enum { TICK, RENDER, READERS };
+	util::snapshot_cell<const handoff_settings, READERS> cell;
+	cell.publish(new handoff_settings);
+	uint64_t revision = 0;
+	settings_handoff(
+		r, "snapshot",
+		[&]() {
+			auto *next = new handoff_settings;
+			next->revision = ++revision;
+			for (auto &v : next->values)
+				v = static_cast<double>(revision);
+			cell.publish(next);
+		},
+		[&](size_t thread, std::chrono::microseconds hold) {
+			auto start = now_ns();
+			util::snapshot_cell<const handoff_settings, READERS>::reader current(cell, thread ? RENDER : TICK);
+			auto waited = now_ns() - start;
+			busy_wait(hold);
+			return waited;
+		});
+}
+
+/* False if the spectra the later steps run on couldn't be made */
+static bool bench_signal(runner &r, const signal &sig)
+{
+	for (auto size : sample_sizes) {
+		bench_transform(r, sig, size);
+
+		/* Spectra of every frame, for the steps after the transform. Plans
+		 * of the configured rigor are made in the background, so wait for them */
+		std::vector<audio::spectrum> spectra[2];
+		for (bool stereo : {false, true}) {
+			audio::fft_stage stage;
+			stage.configure(size, stereo, false, r.opts().fft_rigor);
+			audio::wisdom::plan_cache()->wait();
+			for (size_t f = 0; f < frames; f++) {
+				if (!stage.process(sig.left.data() + f * size, sig.right.data() + f * size)) {
+					std::fprintf(stderr, "Transforming frame %zu of %s at size %u (%s) failed\n", f,
+								 sig.name.c_str(), size, stereo ? "stereo" : "mono");
+					return false;
+				}
+				spectra[stereo].push_back(stage.result());
+			}
+		}
+
+		for (auto detail : details) {
+			for (bool stereo : {false, true})
+				bench_bars(r, sig, size, detail, stereo, spectra[stereo]);
+		}
+	}
+	return true;
+}
+
+static void usage()
+{
+	std::fprintf(stderr, "Usage: spectralizer_bench [options]\n"
+						 "  --min-time <seconds>    Time spent on each benchmark (default 0.05)\n"
+						 "  --filter <text>         Only run benchmarks with text in their name\n"
+						 "  --pcm <file>            Also run on interleaved 16 bit stereo at 44100 Hz\n"
+						 "  --out <file>            Write json there instead of stdout\n"
+						 "  --rigor <estimate|measure|patient>\n"
+						 "                          fftw planning rigor (default measure)\n");
+}
+
+static bool parse_options(int argc, char **argv, options *o)
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (!std::strcmp(arg, "--help") || !std::strcmp(arg, "-h"))
+			return false;
+		if (!value) {
+			std::fprintf(stderr, "Missing value for %s\n", arg);
+			return false;
+		}
+
+		if (!std::strcmp(arg, "--min-time")) {
+			o->min_time = std::atof(value);
+		} else if (!std::strcmp(arg, "--filter")) {
+			o->filter = value;
+		} else if (!std::strcmp(arg, "--pcm")) {
+			o->pcm_path = value;
+		} else if (!std::strcmp(arg, "--out")) {
+			o->out_path = value;
+		} else if (!std::strcmp(arg, "--rigor")) {
+			if (!std::strcmp(value, "estimate"))
+				o->fft_rigor = FR_ESTIMATE;
+			else if (!std::strcmp(value, "measure"))
+				o->fft_rigor = FR_MEASURE;
+			else if (!std::strcmp(value, "patient"))
+				o->fft_rigor = FR_PATIENT;
+			else
+				return false;
+		} else {
+			std::fprintf(stderr, "Unknown option %s\n", arg);
+			return false;
+		}
+		i++;
+	}
+	return o->min_time > 0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	bench::options options;
+	if (!bench::parse_options(argc, argv, &options)) {
+		bench::usage();
+		return 1;
+	}
+
+	const auto largest = *std::max_element(std::begin(bench::sample_sizes), std::end(bench::sample_sizes));
+	const auto samples = bench::frames * largest;
+	std::vector<bench::signal> signals = {bench::sine_sweep(samples, bench::sample_rate), bench::pink_noise(samples),
+										  bench::silence(samples),
+										  bench::stereo_correlated(samples, bench::sample_rate)};
+
+	if (options.pcm_path) {
+		bench::signal recorded;
+		if (!bench::load_pcm16(options.pcm_path, samples, &recorded)) {
+			std::fprintf(stderr, "Can't read pcm from '%s'\n", options.pcm_path);
+			return 1;
+		}
+		signals.push_back(std::move(recorded));
+	}
+
+	FILE *out = stdout;
+	if (options.out_path && !(out = std::fopen(options.out_path, "w"))) {
+		std::fprintf(stderr, "Can't write to '%s'\n", options.out_path);
+		return 1;
+	}
+
+	audio::wisdom::load(nullptr);
+	bench::runner runner(options);
+	bool failed = false;
+	for (const auto &sig : signals) {
+		failed |= !bench::bench_signal(runner, sig);
+		bench::bench_precision(runner, sig);
+	}
+	bench::bench_magnitude(runner);
+	bench::bench_smoothing(runner);
+	bench::bench_configure(runner);
+	bench::bench_settings_handoff(runner);
+	runner.write_json(out);
+	audio::wisdom::unload(nullptr);
+
+	if (out != stdout)
+		std::fclose(out);
+	return failed ? 1 : 0;
+}
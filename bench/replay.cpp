@@ -0,0 +1,360 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "trace.hpp"
+#include "util/audio/fft_wisdom.hpp"
+#include "util/audio/pcm_file.hpp"
+#include "util/audio/spectrum_analyzer.hpp"
+#include "util/histogram.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+/* Streams an audio file through the same analysis a visualizer's tick()
+ * runs, either as fast as possible or paced like live audio. Reports
+ * throughput and can write the bars of every frame to a trace, or
+ * compare them against an earlier one */
+namespace bench {
+
+struct replay_options {
+	const char *path = nullptr;
+	bool raw = false;
+	uint32_t raw_sample_rate = defaults::sample_rate;
+	uint32_t fps = defaults::fps;
+	uint32_t loops = 1;
+	bool realtime = false;
+	const char *trace_path = nullptr;
+	const char *compare_path = nullptr;
+	double tolerance = 1e-3;
+	audio::analysis_settings settings;
+};
+
+/* Compares frames against a trace while they're produced */
+class trace_check {
+	trace_reader m_reader;
+	std::vector<float> m_expected;
+	uint64_t m_frames = 0, m_mismatches = 0;
+	double m_max_error = 0, m_tolerance = 0;
+	bool m_ended = false;
+
+public:
+	bool open(const char *path, const trace_header &header, double tolerance)
+	{
+		m_tolerance = tolerance;
+		if (!m_reader.open(path)) {
+			if (m_reader.header().version != header.version)
+				std::fprintf(stderr, "Trace '%s' has format version %u, this build writes %u\n", path,
+							 m_reader.header().version, header.version);
+			else
+				std::fprintf(stderr, "Can't read trace '%s'\n", path);
+			return false;
+		}
+		if (!(m_reader.header() == header)) {
+			std::fprintf(stderr, "Trace '%s' was made with other settings, this run has\n", path);
+			header.print_differences(m_reader.header(), stderr);
+			return false;
+		}
+		return true;
+	}
+
+	void check(uint64_t tick, const std::vector<float> &values)
+	{
+		uint64_t expected_tick;
+		if (m_ended || !m_reader.next(&expected_tick, &m_expected)) {
+			m_ended = true;
+			++m_mismatches;
+			return;
+		}
+
+		/* A NaN on either side fails the comparison instead of being lost in max() */
+		double error = 0;
+		size_t failed = 0;
+		for (size_t i = 0; i < values.size(); i++) {
+			const auto diff = std::abs(static_cast<double>(values[i]) - m_expected[i]);
+			if (!(diff <= m_tolerance))
+				++failed;
+			if (std::isfinite(diff))
+				error = std::max(error, diff);
+		}
+
+		if (expected_tick != tick) {
+			if (++m_mismatches <= 10)
+				std::fprintf(stderr, "Frame %llu is tick %llu in the trace\n", (unsigned long long)tick,
+							 (unsigned long long)expected_tick);
+		} else if (failed && ++m_mismatches <= 10) {
+			std::fprintf(stderr, "Frame %llu differs from the trace in %zu values, by up to %g\n",
+						 (unsigned long long)tick, failed, error);
+		}
+		m_max_error = std::max(m_max_error, error);
+		++m_frames;
+	}
+
+	/* True if every frame matched and the trace has no frames left */
+	bool finish()
+	{
+		uint64_t tick;
+		while (!m_ended && m_reader.next(&tick, &m_expected))
+			++m_mismatches;
+
+		std::fprintf(stderr, "Compared %llu frames, max error %g, %llu mismatches\n", (unsigned long long)m_frames,
+					 m_max_error, (unsigned long long)m_mismatches);
+		return m_mismatches == 0;
+	}
+};
+
+static void collect(const audio::spectrum_analyzer &analyzer, std::vector<float> *values)
+{
+	values->clear();
+	for (const auto *bars : {&analyzer.bars_left(), &analyzer.bars_right(), &analyzer.falloff_left(),
+							 &analyzer.falloff_right()})
+		values->insert(values->end(), bars->begin(), bars->end());
+}
+
+static int run(const replay_options &o)
+{
+	audio::pcm_file file;
+	if (!file.open(o.path, o.raw, o.raw_sample_rate))
+		return 1;
+
+	auto settings = o.settings;
+	settings.sample_rate = file.sample_rate();
+	settings.sample_size = settings.sample_rate / o.fps;
+	settings.transform = true;
+	if (!settings.sample_size) {
+		std::fprintf(stderr, "Sample rate %u is too low for %u fps\n", settings.sample_rate, o.fps);
+		return 1;
+	}
+
+	audio::spectrum_analyzer analyzer;
+	analyzer.configure(settings);
+	/* Measure rigor plans are made in the background, wait for them like
+	 * a long running visualizer would have */
+	audio::wisdom::plan_cache()->wait();
+
+	trace_header header;
+	header.sample_rate = settings.sample_rate;
+	header.sample_size = settings.sample_size;
+	header.bars = settings.detail + DEAD_BAR_OFFSET;
+	header.channels = settings.stereo ? 2 : 1;
+	header.smoothing = static_cast<uint32_t>(settings.smoothing);
+	header.sgs_points = settings.sgs_points;
+	header.sgs_passes = settings.sgs_passes;
+	header.packed = settings.stereo && settings.stereo_packed;
+	header.mcat_smoothing_factor = settings.mcat_smoothing_factor;
+
+	trace_writer writer;
+	if (o.trace_path && !writer.open(o.trace_path, header)) {
+		std::fprintf(stderr, "Can't write trace '%s'\n", o.trace_path);
+		return 1;
+	}
+	trace_check check;
+	if (o.compare_path && !check.open(o.compare_path, header, o.tolerance))
+		return 1;
+
+	std::vector<float> left(settings.sample_size), right(settings.sample_size), values;
+	values.reserve(header.values());
+
+	const auto tick_seconds = static_cast<float>(settings.sample_size) / settings.sample_rate;
+	const auto tick_duration = std::chrono::duration<double>(tick_seconds);
+	util::histogram frame_times;
+	uint64_t ticks = 0, analyzed = 0, slept = 0;
+	uint32_t loop = 0;
+	bool done = false;
+
+	const auto start = std::chrono::steady_clock::now();
+	while (!done) {
+		if (o.realtime) {
+			auto due = std::chrono::duration_cast<std::chrono::steady_clock::duration>(tick_duration * ticks);
+			std::this_thread::sleep_until(start + due);
+		}
+
+		size_t read = 0;
+		util::stage_timer capture(&analyzer.profile(), util::PS_CAPTURE);
+		while (read < settings.sample_size && !done) {
+			auto count = file.read(left.data() + read, right.data() + read, settings.sample_size - read);
+			read += count;
+			if (!count && (++loop >= o.loops || !file.rewind()))
+				done = true;
+		}
+		capture.stop();
+		if (!read)
+			break;
+		const auto tick = ticks++;
+
+		/* Same as spectrum_visualizer::tick(), but the audio of ticks spent
+		 * asleep is dropped, like live audio that keeps arriving meanwhile */
+		if (analyzer.sleeping(tick_seconds)) {
+			++slept;
+			continue;
+		}
+
+		/* The last buffer is padded with silence */
+		std::fill(left.begin() + read, left.end(), 0.f);
+		std::fill(right.begin() + read, right.end(), 0.f);
+
+		const auto frame_start = std::chrono::steady_clock::now();
+		const auto *spec = analyzer.transform(left.data(), right.data());
+		const bool published = spec && analyzer.analyze_audible(*spec);
+		auto frame_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+																			 frame_start);
+		frame_times.add(static_cast<uint64_t>(frame_ns.count()));
+
+		if (!published)
+			continue;
+		++analyzed;
+		collect(analyzer, &values);
+		writer.write(tick, values);
+		if (o.compare_path)
+			check.check(tick, values);
+	}
+	const auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	writer.close();
+
+	const auto audio_seconds = ticks * static_cast<double>(tick_seconds);
+	const auto frame_count = frame_times.count();
+	std::fprintf(stderr,
+				 "%llu ticks (%.1f s of audio at %u Hz, %u samples per tick): %llu analyzed, %llu asleep\n"
+				 "%.1f s wall time, %.0f ticks/s (%.1fx real time)\n"
+				 "%.2f us per analyzed frame, %.0f frames/s\n",
+				 (unsigned long long)ticks, audio_seconds, settings.sample_rate, settings.sample_size,
+				 (unsigned long long)analyzed, (unsigned long long)slept, wall, ticks / wall, audio_seconds / wall,
+				 frame_times.mean_us(), frame_count ? 1e6 / frame_times.mean_us() : 0.0);
+	frame_times.log(LL_INFO, "Analysis per frame");
+	/* Only has something to say with SPECTRALIZER_PROFILE */
+	analyzer.profile().log(LL_INFO, o.path);
+
+	if (o.compare_path && !check.finish())
+		return 2;
+	return 0;
+}
+
+static void usage()
+{
+	std::fprintf(stderr,
+				 "Usage: spectralizer_replay [options] <file>\n"
+				 "  --raw                   File is headerless interleaved 16 bit stereo (s16le)\n"
+				 "  --rate <hz>             Sample rate of raw files (default 44100)\n"
+				 "  --fps <n>               Ticks per second of audio, samples per tick are rate / fps (default 30)\n"
+				 "  --loops <n>             Play the file n times (default 1)\n"
+				 "  --realtime              Pace ticks like live audio instead of running as fast as possible\n"
+				 "  --trace <file>          Write the bars of every analyzed frame to a trace\n"
+				 "  --compare <file>        Compare bars against a trace, exits with 2 if they differ\n"
+				 "  --tolerance <x>         Largest difference --compare accepts (default 0.001)\n"
+				 "  --detail <n>            Number of bars (default 32)\n"
+				 "  --stereo                Analyze both channels\n"
+				 "  --packing <on|off>      Transform both channels with one complex fft\n"
+				 "  --smoothing <none|monstercat|sgs>\n"
+				 "  --rigor <estimate|measure|patient>\n");
+}
+
+static bool parse_options(int argc, char **argv, replay_options *o)
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (!std::strcmp(arg, "--help") || !std::strcmp(arg, "-h")) {
+			return false;
+		} else if (!std::strcmp(arg, "--raw")) {
+			o->raw = true;
+			continue;
+		} else if (!std::strcmp(arg, "--realtime")) {
+			o->realtime = true;
+			continue;
+		} else if (!std::strcmp(arg, "--stereo")) {
+			o->settings.stereo = true;
+			continue;
+		} else if (std::strncmp(arg, "--", 2) != 0) {
+			if (o->path)
+				return false;
+			o->path = arg;
+			continue;
+		}
+
+		if (!value) {
+			std::fprintf(stderr, "Missing value for %s\n", arg);
+			return false;
+		}
+
+		if (!std::strcmp(arg, "--rate")) {
+			o->raw_sample_rate = static_cast<uint32_t>(std::atoi(value));
+		} else if (!std::strcmp(arg, "--fps")) {
+			o->fps = static_cast<uint32_t>(std::atoi(value));
+		} else if (!std::strcmp(arg, "--loops")) {
+			o->loops = static_cast<uint32_t>(std::atoi(value));
+		} else if (!std::strcmp(arg, "--trace")) {
+			o->trace_path = value;
+		} else if (!std::strcmp(arg, "--compare")) {
+			o->compare_path = value;
+		} else if (!std::strcmp(arg, "--tolerance")) {
+			o->tolerance = std::atof(value);
+		} else if (!std::strcmp(arg, "--detail")) {
+			o->settings.detail = static_cast<uint16_t>(std::atoi(value));
+		} else if (!std::strcmp(arg, "--smoothing")) {
+			if (!std::strcmp(value, "none"))
+				o->settings.smoothing = SM_NONE;
+			else if (!std::strcmp(value, "monstercat"))
+				o->settings.smoothing = SM_MONSTERCAT;
+			else if (!std::strcmp(value, "sgs"))
+				o->settings.smoothing = SM_SGS;
+			else
+				return false;
+		} else if (!std::strcmp(arg, "--packing")) {
+			if (!std::strcmp(value, "on"))
+				o->settings.stereo_packed = true;
+			else if (!std::strcmp(value, "off"))
+				o->settings.stereo_packed = false;
+			else
+				return false;
+		} else if (!std::strcmp(arg, "--rigor")) {
+			if (!std::strcmp(value, "estimate"))
+				o->settings.fft_rigor = FR_ESTIMATE;
+			else if (!std::strcmp(value, "measure"))
+				o->settings.fft_rigor = FR_MEASURE;
+			else if (!std::strcmp(value, "patient"))
+				o->settings.fft_rigor = FR_PATIENT;
+			else
+				return false;
+		} else {
+			std::fprintf(stderr, "Unknown option %s\n", arg);
+			return false;
+		}
+		i++;
+	}
+	return o->path && o->fps > 0 && o->loops > 0 && o->settings.detail > 0 && o->raw_sample_rate > 0;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	bench::replay_options options;
+	if (!bench::parse_options(argc, argv, &options)) {
+		bench::usage();
+		return 1;
+	}
+
+	audio::wisdom::load(nullptr);
+	auto result = bench::run(options);
+	audio::wisdom::unload(nullptr);
+	return result;
+}
@@ -0,0 +1,120 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "signals.hpp"
+#include "util/audio/pcm_convert.hpp"
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+namespace bench {
+
+/* Same seeds every run, so results are comparable between builds */
+class pink_generator {
+	std::mt19937 m_random;
+	std::uniform_real_distribution<float> m_white{-1.f, 1.f};
+	float m_b[7] = {};
+
+public:
+	explicit pink_generator(uint32_t seed) : m_random(seed) {}
+
+	/* Paul Kellett's filter, roughly -3 dB per octave over the audible range */
+	float next()
+	{
+		auto white = m_white(m_random);
+		m_b[0] = 0.99886f * m_b[0] + white * 0.0555179f;
+		m_b[1] = 0.99332f * m_b[1] + white * 0.0750759f;
+		m_b[2] = 0.96900f * m_b[2] + white * 0.1538520f;
+		m_b[3] = 0.86650f * m_b[3] + white * 0.3104856f;
+		m_b[4] = 0.55000f * m_b[4] + white * 0.5329522f;
+		m_b[5] = -0.7616f * m_b[5] - white * 0.0168980f;
+		auto pink = m_b[0] + m_b[1] + m_b[2] + m_b[3] + m_b[4] + m_b[5] + m_b[6] + white * 0.5362f;
+		m_b[6] = white * 0.115926f;
+		return pink * 0.11f;
+	}
+};
+
+signal sine_sweep(size_t samples, uint32_t sample_rate)
+{
+	signal out{"sine_sweep", std::vector<float>(samples), {}};
+	const double f0 = 20, f1 = 20000;
+	const double duration = static_cast<double>(samples) / sample_rate, rate = std::log(f1 / f0);
+
+	for (size_t i = 0; i < samples; i++) {
+		auto t = static_cast<double>(i) / sample_rate;
+		auto phase = 2 * UTIL_PI * f0 * duration / rate * (std::exp(t / duration * rate) - 1);
+		out.left[i] = static_cast<float>(0.5 * std::sin(phase));
+	}
+	out.right = out.left;
+	return out;
+}
+
+signal pink_noise(size_t samples)
+{
+	signal out{"pink_noise", std::vector<float>(samples), std::vector<float>(samples)};
+	pink_generator left(1), right(2);
+
+	for (size_t i = 0; i < samples; i++) {
+		out.left[i] = left.next();
+		out.right[i] = right.next();
+	}
+	return out;
+}
+
+signal silence(size_t samples)
+{
+	return {"silence", std::vector<float>(samples), std::vector<float>(samples)};
+}
+
+signal stereo_correlated(size_t samples, uint32_t sample_rate)
+{
+	signal out{"stereo_correlated", std::vector<float>(samples), std::vector<float>(samples)};
+	pink_generator shared(3), own(4);
+
+	for (size_t i = 0; i < samples; i++) {
+		auto phase = 2 * UTIL_PI * static_cast<double>(i) / sample_rate;
+		auto tones = 0.25 * std::sin(phase * 440) + 0.1 * std::sin(phase * 2500);
+		out.left[i] = static_cast<float>(tones + 0.5 * shared.next());
+		out.right[i] = 0.8f * out.left[i] + 0.2f * own.next();
+	}
+	return out;
+}
+
+bool load_pcm16(const char *path, size_t samples, signal *out)
+{
+	auto *file = std::fopen(path, "rb");
+	if (!file)
+		return false;
+
+	std::vector<pcm_stereo_sample> pcm(samples);
+	auto read = std::fread(pcm.data(), sizeof(pcm_stereo_sample), samples, file);
+	std::fclose(file);
+	if (!read)
+		return false;
+
+	for (size_t i = read; i < samples; i++)
+		pcm[i] = pcm[i % read];
+
+	out->name = "recorded";
+	out->left.resize(samples);
+	out->right.resize(samples);
+	audio::pcm16_to_planar(pcm.data(), samples, out->left.data(), out->right.data());
+	return true;
+}
+
+}
@@ -0,0 +1,49 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/* Planar test audio with obs' full scale of 1 */
+struct signal {
+	std::string name;
+	std::vector<float> left, right;
+};
+
+/* Exponential sweep from 20 Hz to 20 kHz, same on both channels */
+signal sine_sweep(size_t samples, uint32_t sample_rate);
+
+/* Independent pink noise on each channel */
+signal pink_noise(size_t samples);
+
+signal silence(size_t samples);
+
+/* Two tones over pink noise on the left, the right channel is mostly the
+ * left one with some noise of its own, like a typical stereo mix */
+signal stereo_correlated(size_t samples, uint32_t sample_rate);
+
+/* Interleaved 16 bit stereo, repeated until it's samples long.
+ * False if the file can't be read or is empty */
+bool load_pcm16(const char *path, size_t samples, signal *out);
+
+}
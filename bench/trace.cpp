@@ -0,0 +1,154 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "trace.hpp"
+#include <cstring>
+
+namespace bench {
+
+static const char magic[4] = {'S', 'P', 'T', 'R'};
+static const size_t header_fields = 9;
+
+bool trace_header::operator==(const trace_header &o) const
+{
+	return version == o.version && sample_rate == o.sample_rate && sample_size == o.sample_size && bars == o.bars &&
+		   channels == o.channels && smoothing == o.smoothing && sgs_points == o.sgs_points &&
+		   sgs_passes == o.sgs_passes && packed == o.packed && mcat_smoothing_factor == o.mcat_smoothing_factor;
+}
+
+void trace_header::print_differences(const trace_header &o, FILE *f) const
+{
+	const struct {
+		const char *name;
+		uint32_t mine, theirs;
+	} fields[] = {{"version", version, o.version},
+				  {"sample rate", sample_rate, o.sample_rate},
+				  {"sample size", sample_size, o.sample_size},
+				  {"bars", bars, o.bars},
+				  {"channels", channels, o.channels},
+				  {"smoothing mode", smoothing, o.smoothing},
+				  {"sgs points", sgs_points, o.sgs_points},
+				  {"sgs passes", sgs_passes, o.sgs_passes},
+				  {"packed stereo", packed, o.packed}};
+
+	for (const auto &field : fields) {
+		if (field.mine != field.theirs)
+			std::fprintf(f, "  %s: %u instead of %u\n", field.name, field.mine, field.theirs);
+	}
+	if (mcat_smoothing_factor != o.mcat_smoothing_factor)
+		std::fprintf(f, "  monstercat smoothing factor: %g instead of %g\n", mcat_smoothing_factor,
+					 o.mcat_smoothing_factor);
+}
+
+trace_writer::~trace_writer()
+{
+	close();
+}
+
+bool trace_writer::open(const char *path, const trace_header &header)
+{
+	close();
+	m_file = std::fopen(path, "wb");
+	if (!m_file)
+		return false;
+
+	const uint32_t fields[header_fields] = {header.version, header.sample_rate, header.sample_size,
+											header.bars, header.channels, header.smoothing,
+											header.sgs_points, header.sgs_passes, header.packed};
+	std::fwrite(magic, 1, sizeof(magic), m_file);
+	std::fwrite(fields, sizeof(uint32_t), header_fields, m_file);
+	std::fwrite(&header.mcat_smoothing_factor, sizeof(double), 1, m_file);
+	return true;
+}
+
+void trace_writer::write(uint64_t tick, const std::vector<float> &values)
+{
+	if (!m_file)
+		return;
+	std::fwrite(&tick, sizeof(tick), 1, m_file);
+	std::fwrite(values.data(), sizeof(float), values.size(), m_file);
+}
+
+void trace_writer::close()
+{
+	if (m_file)
+		std::fclose(m_file);
+	m_file = nullptr;
+}
+
+trace_reader::~trace_reader()
+{
+	close();
+}
+
+bool trace_reader::open(const char *path)
+{
+	close();
+	m_file = std::fopen(path, "rb");
+	if (!m_file)
+		return false;
+
+	char file_magic[4];
+	m_header = trace_header();
+	if (std::fread(file_magic, 1, sizeof(file_magic), m_file) != sizeof(file_magic) ||
+		std::memcmp(file_magic, magic, sizeof(magic)) ||
+		std::fread(&m_header.version, sizeof(uint32_t), 1, m_file) != 1) {
+		close();
+		return false;
+	}
+	/* Older versions have fewer fields, they can't be compared anyway */
+	if (m_header.version != trace_header::current_version) {
+		close();
+		return false;
+	}
+
+	uint32_t fields[header_fields - 1];
+	if (std::fread(fields, sizeof(uint32_t), header_fields - 1, m_file) != header_fields - 1 ||
+		std::fread(&m_header.mcat_smoothing_factor, sizeof(double), 1, m_file) != 1) {
+		close();
+		return false;
+	}
+
+	m_header.sample_rate = fields[0];
+	m_header.sample_size = fields[1];
+	m_header.bars = fields[2];
+	m_header.channels = fields[3];
+	m_header.smoothing = fields[4];
+	m_header.sgs_points = fields[5];
+	m_header.sgs_passes = fields[6];
+	m_header.packed = fields[7];
+	return true;
+}
+
+bool trace_reader::next(uint64_t *tick, std::vector<float> *values)
+{
+	if (!m_file)
+		return false;
+	values->resize(m_header.values());
+	return std::fread(tick, sizeof(*tick), 1, m_file) == 1 &&
+		   std::fread(values->data(), sizeof(float), values->size(), m_file) == values->size();
+}
+
+void trace_reader::close()
+{
+	if (m_file)
+		std::fclose(m_file);
+	m_file = nullptr;
+}
+
+}
@@ -0,0 +1,75 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace bench {
+
+/* Bars of every analyzed frame, written by spectralizer_replay to compare
+ * runs against each other. All values are little endian:
+ *   header: "SPTR", then u32 version, sample rate, sample size, bars, channels,
+ *           smoothing mode, sgs points, sgs passes, packed stereo (0 or 1),
+ *           then f64 monstercat smoothing factor
+ *   frame:  u64 tick, then f32 bars of each channel, then the falloff of each channel */
+struct trace_header {
+	static const uint32_t current_version = 2;
+
+	uint32_t version = current_version;
+	uint32_t sample_rate = 0, sample_size = 0;
+	uint32_t bars = 0, channels = 0;
+	uint32_t smoothing = 0, sgs_points = 0, sgs_passes = 0, packed = 0;
+	double mcat_smoothing_factor = 0;
+
+	size_t values() const { return static_cast<size_t>(bars) * channels * 2; }
+	bool operator==(const trace_header &o) const;
+	/* Writes what differs from o to f, one setting per line */
+	void print_differences(const trace_header &o, FILE *f) const;
+};
+
+class trace_writer {
+	FILE *m_file = nullptr;
+	std::vector<float> m_values;
+
+public:
+	~trace_writer();
+	bool open(const char *path, const trace_header &header);
+	/* values() values in the order described above */
+	void write(uint64_t tick, const std::vector<float> &values);
+	void close();
+};
+
+class trace_reader {
+	FILE *m_file = nullptr;
+	trace_header m_header;
+
+public:
+	~trace_reader();
+	/* False if it can't be read or is of another version, header().version
+	 * still tells which one it is if only the version is wrong */
+	bool open(const char *path);
+	/* False at the end of the trace */
+	bool next(uint64_t *tick, std::vector<float> *values);
+	void close();
+
+	const trace_header &header() const { return m_header; }
+};
+
+}
@@ -19,12 +19,17 @@
 #include "visualizer_source.hpp"
 #include "../util/audio/bar_visualizer.hpp"
 #include "../util/audio/wire_visualizer.hpp"
+#include "../util/alloc_tracker.hpp"
+#include "../util/thread_pool.hpp"
 #include "../util/util.hpp"
+#include <util/platform.h>
 
 namespace source {
 
 static auto fifo_filter = "Fifo file(*.fifo);;"
 						  "All Files (*.*)";
+static auto replay_filter = "Wave file(*.wav);;"
+							"All Files (*.*)";
 
 struct enum_data {
 	visualizer_source *vis;
@@ -35,121 +40,256 @@ visualizer_source::visualizer_source(obs_source_t *source, obs_data_t *settings)
 {
 	m_config.settings = settings;
 	m_config.source = source;
+	m_config.listener = this;
+	os_event_init(&m_pool_idle, OS_EVENT_TYPE_AUTO);
 
 	update(settings);
 }
 
 visualizer_source::~visualizer_source()
 {
-	m_config.value_mutex.lock();
-	delete m_visualizer;
-	m_visualizer = nullptr;
+	m_leaving = true;
+	while (!leave_pool())
+		os_event_wait(m_pool_idle);
 
-	if (m_config.buffer) {
-		bfree(m_config.buffer);
-		m_config.buffer = nullptr;
+	/* No thread is ticking or rendering anymore */
+	m_visualizer.publish(nullptr);
+
+	for (auto &buf : m_config.buffer) {
+		bfree(buf);
+		buf = nullptr;
 	}
-	m_config.value_mutex.unlock();
+
+	if (m_ticks)
+		debug("Spent %.3f ms on average in video tick over %llu ticks", m_tick_ns / (m_ticks * 1000000.0),
+			  static_cast<unsigned long long>(m_ticks));
+	os_event_destroy(m_pool_idle);
 }
 
 void visualizer_source::update(obs_data_t *settings)
 {
-	visual_mode old_mode = m_config.visual;
-
-	m_config.value_mutex.lock();
-	m_config.audio_source_name = obs_data_get_string(settings, S_AUDIO_SOURCE);
-	m_config.sample_rate = obs_data_get_int(settings, S_SAMPLE_RATE);
-	m_config.sample_size = m_config.sample_rate / m_config.fps;
-	m_config.visual = (visual_mode)(obs_data_get_int(settings, S_SOURCE_MODE));
-	m_config.stereo = obs_data_get_bool(settings, S_STEREO);
-	m_config.stereo_space = obs_data_get_int(settings, S_STEREO_SPACE);
-	m_config.color = obs_data_get_int(settings, S_COLOR);
-	m_config.bar_width = obs_data_get_int(settings, S_BAR_WIDTH);
-	m_config.bar_space = obs_data_get_int(settings, S_BAR_SPACE);
-	m_config.detail = obs_data_get_int(settings, S_DETAIL);
-	m_config.fifo_path = obs_data_get_string(settings, S_FIFO_PATH);
-	m_config.bar_height = obs_data_get_int(settings, S_BAR_HEIGHT);
-	m_config.smoothing = (smooting_mode)obs_data_get_int(settings, S_FILTER_MODE);
-	m_config.sgs_passes = obs_data_get_int(settings, S_SGS_PASSES);
-	m_config.sgs_points = obs_data_get_int(settings, S_SGS_POINTS);
-	m_config.falloff_weight = obs_data_get_double(settings, S_FALLOFF);
-	m_config.gravity = obs_data_get_double(settings, S_GRAVITY);
-	m_config.mcat_smoothing_factor = obs_data_get_double(settings, S_FILTER_STRENGTH);
-	m_config.cx = UTIL_MAX(m_config.detail * (m_config.bar_width + m_config.bar_space) - m_config.bar_space, 10);
-	m_config.cy = UTIL_MAX(m_config.bar_height + (m_config.stereo ? m_config.stereo_space : 0), 10);
-	m_config.use_auto_scale = obs_data_get_bool(settings, S_AUTO_SCALE);
-	m_config.scale_boost = obs_data_get_double(settings, S_SCALE_BOOST);
-	m_config.scale_size = obs_data_get_double(settings, S_SCALE_SIZE);
-	m_config.wire_mode = (wire_mode)obs_data_get_int(settings, S_WIRE_MODE);
-	m_config.wire_thickness = obs_data_get_int(settings, S_WIRE_THICKNESS);
+	/* Runs on whatever thread changed the settings, so this only
+	 * builds a new snapshot, which the video thread picks up on its next tick */
+	auto *cfg = new config;
+	cfg->revision = ++m_revision;
+	cfg->settings = settings;
+	cfg->source = m_config.source;
+	cfg->audio_source_name = obs_data_get_string(settings, S_AUDIO_SOURCE);
+	cfg->sample_rate = obs_data_get_int(settings, S_SAMPLE_RATE);
+	cfg->visual = (visual_mode)(obs_data_get_int(settings, S_SOURCE_MODE));
+	cfg->stereo = obs_data_get_bool(settings, S_STEREO);
+	cfg->stereo_space = obs_data_get_int(settings, S_STEREO_SPACE);
+	cfg->stereo_packed = obs_data_get_bool(settings, S_STEREO_PACKED);
+	cfg->color = obs_data_get_int(settings, S_COLOR);
+	cfg->bar_width = obs_data_get_int(settings, S_BAR_WIDTH);
+	cfg->bar_space = obs_data_get_int(settings, S_BAR_SPACE);
+	cfg->detail = obs_data_get_int(settings, S_DETAIL);
+	cfg->fifo_path = obs_data_get_string(settings, S_FIFO_PATH);
+	cfg->replay_path = obs_data_get_string(settings, S_REPLAY_PATH);
+	cfg->bar_height = obs_data_get_int(settings, S_BAR_HEIGHT);
+	cfg->smoothing = (smooting_mode)obs_data_get_int(settings, S_FILTER_MODE);
+	cfg->sgs_passes = obs_data_get_int(settings, S_SGS_PASSES);
+	cfg->sgs_points = obs_data_get_int(settings, S_SGS_POINTS);
+	cfg->falloff_weight = obs_data_get_double(settings, S_FALLOFF);
+	cfg->gravity = obs_data_get_double(settings, S_GRAVITY);
+	cfg->mcat_smoothing_factor = obs_data_get_double(settings, S_FILTER_STRENGTH);
+	cfg->cx = UTIL_MAX(cfg->detail * (cfg->bar_width + cfg->bar_space) - cfg->bar_space, 10);
+	cfg->cy = UTIL_MAX(cfg->bar_height + (cfg->stereo ? cfg->stereo_space : 0), 10);
+	cfg->use_auto_scale = obs_data_get_bool(settings, S_AUTO_SCALE);
+	cfg->scale_boost = obs_data_get_double(settings, S_SCALE_BOOST);
+	cfg->scale_size = obs_data_get_double(settings, S_SCALE_SIZE);
+	cfg->wire_mode = (wire_mode)obs_data_get_int(settings, S_WIRE_MODE);
+	cfg->wire_thickness = obs_data_get_int(settings, S_WIRE_THICKNESS);
+	cfg->fft_rigor = (fft_rigor)obs_data_get_int(settings, S_FFT_RIGOR);
+	cfg->analysis_thread = obs_data_get_bool(settings, S_ANALYSIS_THREAD);
 
 #ifdef LINUX
-	m_config.auto_clear = obs_data_get_bool(settings, S_AUTO_CLEAR);
+	cfg->auto_clear = obs_data_get_bool(settings, S_AUTO_CLEAR);
 
 	struct obs_video_info ovi;
 	if (obs_get_video_info(&ovi)) {
-		m_config.fps = ovi.fps_num;
+		cfg->fps = ovi.fps_num;
 	} else {
-		m_config.fps = 30;
+		cfg->fps = 30;
 		warn("Couldn't determine fps, mpd fifo might not work as intended!");
 	}
 #endif
+	cfg->sample_size = cfg->sample_rate / cfg->fps;
 
-	if (m_visualizer) /* this modifies sample size, if an internal audio source is used */
-		m_visualizer->update();
+	m_cx = cfg->cx;
+	m_cy = cfg->cy;
+	m_settings.publish(cfg);
+}
 
-	if (m_config.buffer)
-		bfree(m_config.buffer);
+void visualizer_source::apply_settings(const config &cfg, audio::audio_visualizer *visualizer)
+{
+	visual_mode old_mode = m_config.visual;
+	float *buffer[2] = { m_config.buffer[0], m_config.buffer[1] };
 
-	m_config.buffer = static_cast<pcm_stereo_sample *>(bzalloc(m_config.sample_size * sizeof(pcm_stereo_sample)));
+	m_config = cfg;
+	m_config.buffer[0] = buffer[0];
+	m_config.buffer[1] = buffer[1];
+	m_config.listener = this;
 
-	if (old_mode != m_config.visual || !m_visualizer) {
-		delete m_visualizer;
+	if (visualizer) /* this modifies sample size, if an internal audio source is used */
+		visualizer->update();
 
+	if (old_mode != m_config.visual || !visualizer) {
 		switch (m_config.visual) {
 		case VM_BARS:
-			m_visualizer = new audio::bar_visualizer(&m_config);
+			visualizer = new audio::bar_visualizer(&m_config);
 			break;
 		case VM_WIRE:
-			m_visualizer = new audio::wire_visualizer(&m_config);
+			visualizer = new audio::wire_visualizer(&m_config);
 			break;
 		}
+		/* The old one is deleted once render is done with it */
+		m_visualizer.publish(visualizer);
+	}
+
+	/* Internal audio sources decide the sample size, so this
+	 * has to happen after the visualizer has been updated or created */
+	for (auto &buf : m_config.buffer) {
+		bfree(buf);
+		buf = static_cast<float *>(bzalloc(m_config.sample_size * sizeof(float)));
+	}
+}
+
+void visualizer_source::analyze(float seconds)
+{
+	{
+		util::snapshot_cell<const config, SR_COUNT>::reader cfg(m_settings, SR_ANALYSIS);
+		util::snapshot_cell<audio::audio_visualizer, SR_COUNT>::reader visualizer(m_visualizer, SR_ANALYSIS);
+		if (cfg && cfg->revision != m_config.revision)
+			apply_settings(*cfg, visualizer.get());
+	}
+
+	m_visualizer.collect();
+	util::snapshot_cell<audio::audio_visualizer, SR_COUNT>::reader visualizer(m_visualizer, SR_ANALYSIS);
+	if (visualizer) {
+		util::no_alloc_scope scope("tick", visualizer->warmed_up() && !visualizer->source_changed());
+		visualizer->tick(seconds);
+	}
+}
+
+void visualizer_source::analysis_job(bool poll)
+{
+	auto audio_ready = [this]() {
+		util::snapshot_cell<audio::audio_visualizer, SR_COUNT>::reader visualizer(m_visualizer, SR_ANALYSIS);
+		return visualizer && visualizer->audio_ready();
+	};
+
+	/* Internal audio picks its sample size so that one buffer is one
+	 * video frame, so analyzing every full buffer runs at the frame rate
+	 * on average. Polls run once to apply settings and let the bars fall */
+	bool run = poll || audio_ready();
+	while (run) {
+		uint64_t now = os_gettime_ns();
+		uint64_t last = m_last_analysis_ns.exchange(now);
+		analyze(last ? (now - last) / 1000000000.f : 0.f);
+
+		{
+			util::snapshot_cell<audio::audio_visualizer, SR_COUNT>::reader visualizer(m_visualizer, SR_ANALYSIS);
+			m_event_driven = visualizer && visualizer->event_driven();
+		}
+		run = m_event_driven && audio_ready();
 	}
 
-	m_config.value_mutex.unlock();
+	/* Audio that arrives between the last check and this is
+	 * picked up by the job the next capture queues */
+	m_job_queued = false;
+	release_pool_ref();
+}
+
+bool visualizer_source::queue_analysis(bool poll)
+{
+	auto *pool = util::pool::get();
+	if (!pool || m_job_queued.exchange(true))
+		return false;
+
+	++m_pool_refs;
+	if (!pool->submit(util::JOB_ANALYSIS, [this, poll]() { analysis_job(poll); })) {
+		/* The next tick polls instead */
+		m_job_queued = false;
+		release_pool_ref();
+		return false;
+	}
+	return true;
+}
+
+void visualizer_source::release_pool_ref()
+{
+	/* Only signals while the source is being destroyed, so
+	 * the audio thread doesn't touch the event otherwise */
+	if (--m_pool_refs == 0 && m_leaving)
+		os_event_signal(m_pool_idle);
+}
+
+void visualizer_source::audio_arrived()
+{
+	++m_pool_refs;
+	if (m_pooled)
+		queue_analysis(false);
+	release_pool_ref();
+}
+
+bool visualizer_source::leave_pool()
+{
+	/* Once no call is in progress every later one sees m_pooled
+	 * unset, so after that only the queued job is left to wait for */
+	m_pooled = false;
+	return m_pool_refs == 0;
 }
 
 void visualizer_source::tick(float seconds)
 {
-	m_config.value_mutex.lock();
+	uint64_t start = os_gettime_ns();
+	bool pooled;
+	{
+		util::snapshot_cell<const config, SR_COUNT>::reader cfg(m_settings, SR_VIDEO);
+		pooled = cfg && cfg->analysis_thread && util::pool::get();
+	}
 
-	if (m_visualizer)
-		m_visualizer->tick(seconds);
+	if (pooled) {
+		m_pooled = true;
+		/* Sources without audio events (fifo) are polled at the frame rate */
+		if (!m_event_driven || start - m_last_analysis_ns > constants::analysis_idle_ns)
+			queue_analysis(true);
+	} else if (leave_pool()) {
+		/* Skipped while a job is still finishing */
+		m_last_analysis_ns = start;
+		analyze(seconds);
+	}
 
-	m_config.value_mutex.unlock();
+	m_tick_ns += os_gettime_ns() - start;
+	++m_ticks;
 }
 
 void visualizer_source::render(gs_effect_t *effect)
 {
 	UNUSED_PARAMETER(effect);
-	if (m_visualizer) {
-		m_config.value_mutex.lock();
+	util::snapshot_cell<const config, SR_COUNT>::reader cfg(m_settings, SR_RENDER);
+	util::snapshot_cell<audio::audio_visualizer, SR_COUNT>::reader visualizer(m_visualizer, SR_RENDER);
+
+	if (visualizer && cfg) {
 		gs_effect_t *solid = obs_get_base_effect(OBS_EFFECT_SOLID);
 		gs_eparam_t *color = gs_effect_get_param_by_name(solid, "color");
 		gs_technique_t *tech = gs_effect_get_technique(solid, "Solid");
 
 		struct vec4 colorVal;
-		vec4_from_rgba(&colorVal, m_config.color);
+		vec4_from_rgba(&colorVal, cfg->color);
 		gs_effect_set_vec4(color, &colorVal);
 
 		gs_technique_begin(tech);
 		gs_technique_begin_pass(tech, 0);
 
-		m_visualizer->render(solid);
+		{
+			util::no_alloc_scope scope("render", visualizer->warmed_up());
+			visualizer->render(solid, cfg.get());
+		}
 
 		gs_technique_end_pass(tech);
 		gs_technique_end(tech);
-		m_config.value_mutex.unlock();
 	}
 }
 
@@ -201,6 +341,7 @@ static bool source_changed(obs_properties_t *props, obs_property_t *p, obs_data_
 			obs_property_set_visible(fifo, true);
 		}
 	}
+	obs_property_set_visible(obs_properties_get(props, S_REPLAY_PATH), strcmp(id, "replay") == 0);
 	return true;
 }
 
@@ -208,7 +349,9 @@ static bool stereo_changed(obs_properties_t *props, obs_property_t *p, obs_data_
 {
 	auto stereo = obs_data_get_bool(data, S_STEREO);
 	auto *space = obs_properties_get(props, S_STEREO_SPACE);
+	auto *packed = obs_properties_get(props, S_STEREO_PACKED);
 	obs_property_set_visible(space, stereo);
+	obs_property_set_visible(packed, stereo);
 	return true;
 }
 
@@ -320,6 +463,10 @@ obs_properties_t *get_properties_for_visualiser(void *data)
 	obs_property_set_visible(path, false);
 	obs_properties_add_bool(props, S_AUTO_CLEAR, T_AUTO_CLEAR);
 #endif
+	/* Wav files, to reproduce what the visualizer does with known audio */
+	obs_property_list_add_string(src, T_SOURCE_REPLAY, "replay");
+	auto *replay = obs_properties_add_path(props, S_REPLAY_PATH, T_REPLAY_PATH, OBS_PATH_FILE, replay_filter, "");
+	obs_property_set_visible(replay, false);
 
 	auto *stereo = obs_properties_add_bool(props, S_STEREO, T_STEREO);
 	auto *space = obs_properties_add_int(props, S_STEREO_SPACE, T_STEREO_SPACE, 0, UINT16_MAX, 1);
@@ -327,8 +474,16 @@ obs_properties_t *get_properties_for_visualiser(void *data)
 	auto *dt = obs_properties_add_int(props, S_DETAIL, T_DETAIL, 1, UINT16_MAX, 1);
 	obs_property_int_set_suffix(dt, " Bins");
 	obs_property_set_visible(space, false);
+	obs_property_set_visible(obs_properties_add_bool(props, S_STEREO_PACKED, T_STEREO_PACKED), false);
 	obs_property_set_modified_callback(stereo, stereo_changed);
 
+	obs_properties_add_bool(props, S_ANALYSIS_THREAD, T_ANALYSIS_THREAD);
+
+	auto *rigor = obs_properties_add_list(props, S_FFT_RIGOR, T_FFT_RIGOR, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(rigor, T_FFT_RIGOR_ESTIMATE, FR_ESTIMATE);
+	obs_property_list_add_int(rigor, T_FFT_RIGOR_MEASURE, FR_MEASURE);
+	obs_property_list_add_int(rigor, T_FFT_RIGOR_PATIENT, FR_PATIENT);
+
 	enum_data d;
 	d.list = src;
 	d.vis = reinterpret_cast<visualizer_source *>(data);
@@ -356,6 +511,7 @@ void register_visualiser()
 		obs_data_set_default_int(settings, S_COLOR, 0xFFFFFFFF);
 		obs_data_set_default_int(settings, S_DETAIL, defaults::detail);
 		obs_data_set_default_bool(settings, S_STEREO, defaults::stereo);
+		obs_data_set_default_bool(settings, S_STEREO_PACKED, defaults::stereo_packed);
 		obs_data_set_default_int(settings, S_SOURCE_MODE, (int)VM_BARS);
 		obs_data_set_default_string(settings, S_AUDIO_SOURCE, defaults::audio_source);
 		obs_data_set_default_int(settings, S_SAMPLE_RATE, defaults::sample_rate);
@@ -374,6 +530,8 @@ void register_visualiser()
 		obs_data_set_default_double(settings, S_SCALE_BOOST, defaults::scale_boost);
 		obs_data_set_default_int(settings, S_WIRE_MODE, defaults::wire_mode);
 		obs_data_set_default_int(settings, S_WIRE_THICKNESS, defaults::wire_thickness);
+		obs_data_set_default_int(settings, S_FFT_RIGOR, defaults::fft_rigor);
+		obs_data_set_default_bool(settings, S_ANALYSIS_THREAD, defaults::analysis_thread);
 	};
 
 	si.update = [](void *data, obs_data_t *settings) { reinterpret_cast<visualizer_source *>(data)->update(settings); };
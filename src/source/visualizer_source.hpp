@@ -6,11 +6,15 @@
  */
 #pragma once
 
+#include "../util/audio/audio_source.hpp"
+#include "../util/snapshot.hpp"
 #include "../util/util.hpp"
+#include <atomic>
 #include <cstdint>
 #include <map>
 #include <mutex>
 #include <obs-module.h>
+#include <util/threading.h>
 
 namespace audio {
 class audio_visualizer;
@@ -18,17 +22,23 @@ class audio_visualizer;
 
 namespace source {
 
+/* Settings are published by update() as immutable snapshots. The video
+ * thread keeps its own working copy, which the visualizer and audio source
+ * point to and may adjust (e.g. the sample size of internal audio) */
 struct config {
-	std::mutex value_mutex;
+	uint64_t revision = 0; /* Increased by every update() */
 
 	/* obs source stuff */
 	obs_source_t *source = nullptr;
 	obs_data_t *settings = nullptr;
 
 	/* Misc */
-	const char *fifo_path = defaults::fifo_path;
+	std::string fifo_path = defaults::fifo_path;
+	std::string replay_path = "";
 	bool auto_clear = false;
-	pcm_stereo_sample *buffer = nullptr;
+	/* Only set in the working copy */
+	float *buffer[2] = {};                     /* Planar left & right audio, sample_size long each */
+	audio::audio_listener *listener = nullptr; /* Told by the audio source when new audio arrived */
 
 	/* Appearance settings */
 	visual_mode visual = defaults::visual;
@@ -40,6 +50,8 @@ struct config {
 	/* Audio settings */
 	uint32_t sample_rate = defaults::sample_rate;
 	uint32_t sample_size = defaults::sample_size;
+	enum fft_rigor fft_rigor = defaults::fft_rigor;
+	bool analysis_thread = defaults::analysis_thread;
 
 	std::string audio_source_name = "";
 	double low_cutoff_freq = defaults::lfreq_cut;
@@ -68,26 +80,64 @@ struct config {
 	/* General spectrum settings */
 	bool stereo = defaults::stereo;
 	uint16_t stereo_space = 0;
+	bool stereo_packed = defaults::stereo_packed;
 	double falloff_weight = defaults::falloff_weight;
 	double gravity = defaults::gravity;
 };
 
-class visualizer_source {
-	config m_config;
-	audio::audio_visualizer *m_visualizer = nullptr;
+/* Threads reading settings snapshots, each one gets its own slot.
+ * Analysis runs either on the video thread or as a job on the
+ * thread pool, never on both at once */
+enum snapshot_reader { SR_ANALYSIS, SR_VIDEO, SR_RENDER, SR_COUNT };
+
+class visualizer_source : public audio::audio_listener {
+	util::snapshot_cell<const config, SR_COUNT> m_settings;
+	std::atomic<uint64_t> m_revision{0};
+	std::atomic<uint32_t> m_cx{defaults::cx}, m_cy{defaults::cy};
+
+	config m_config; /* Working copy, only touched by the thread doing analysis */
+	/* Replaced by tick when the mode changes, render only reads the
+	 * visualizer's published frames so it can keep using an old one */
+	util::snapshot_cell<audio::audio_visualizer, SR_COUNT> m_visualizer;
 	std::map<uint16_t, std::string> m_source_names;
 
+	/* With analysis_thread set, audio arrival queues analysis jobs on the
+	 * shared pool instead of analyzing on the video clock. At most one job
+	 * is queued or running, which makes it the owner of the working copy */
+	std::atomic<bool> m_pooled{false};
+	std::atomic<bool> m_job_queued{false};
+	/* audio_arrived() calls in progress plus the queued job, the destructor
+	 * sets m_leaving and waits for m_pool_idle once they're done */
+	std::atomic<int> m_pool_refs{0};
+	std::atomic<bool> m_leaving{false};
+	os_event_t *m_pool_idle = nullptr;
+	std::atomic<bool> m_event_driven{false};
+	std::atomic<uint64_t> m_last_analysis_ns{0};
+
+	/* Time spent in video_tick, to compare both modes */
+	uint64_t m_tick_ns = 0, m_ticks = 0;
+
+	void apply_settings(const config &cfg, audio::audio_visualizer *visualizer);
+	void analyze(float seconds);
+	void analysis_job(bool poll);
+	bool queue_analysis(bool poll);
+	void release_pool_ref();
+	/* Makes sure no job is or will be running, false if one still is */
+	bool leave_pool();
+
 public:
 	visualizer_source(obs_source_t *source, obs_data_t *settings);
-	~visualizer_source();
+	~visualizer_source() override;
 
 	inline void update(obs_data_t *settings);
 	inline void tick(float seconds);
 	inline void render(gs_effect_t *effect);
 
-	uint32_t get_width() const { return m_config.cx; }
+	void audio_arrived() override;
+
+	uint32_t get_width() const { return m_cx; }
 
-	uint32_t get_height() const { return m_config.cy; }
+	uint32_t get_height() const { return m_cy; }
 
 	void clear_source_names() { m_source_names.clear(); }
 	void add_source(uint16_t id, const char *name) { m_source_names[id] = name; }
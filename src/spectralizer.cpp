@@ -17,7 +17,12 @@
  *************************************************************************/
 
 #include "source/visualizer_source.hpp"
+#include "util/audio/fft_wisdom.hpp"
+#include "util/audio/magnitude.hpp"
+#include "util/audio/pcm_convert.hpp"
+#include "util/thread_pool.hpp"
 #include <obs-module.h>
+#include <util/platform.h>
 
 OBS_DECLARE_MODULE()
 
@@ -30,11 +35,28 @@ MODULE_EXPORT const char *obs_module_description(void)
 
 bool obs_module_load()
 {
+	util::set_log_sink(blogva);
+
+	char *wisdom_path = obs_module_config_path(audio::fft::wisdom_file);
+	audio::wisdom::load(wisdom_path);
+	bfree(wisdom_path);
+
+	info("Using %s pcm conversion and %s spectrum kernel", audio::pcm_kernel_name(), audio::spectrum_kernel_name());
+	util::pool::start();
 	source::register_visualiser();
 	return true;
 }
 
 void obs_module_unload()
 {
-	/* NO-OP */
+	util::pool::stop();
+
+	char *dir = obs_module_config_path("");
+	char *wisdom_path = obs_module_config_path(audio::fft::wisdom_file);
+	if (dir)
+		os_mkdirs(dir);
+	audio::wisdom::unload(dir ? wisdom_path : nullptr);
+	bfree(dir);
+	bfree(wisdom_path);
+	util::set_log_sink(nullptr);
 }
@@ -0,0 +1,108 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "alloc_tracker.hpp"
+
+#ifdef SPECTRALIZER_TRACK_ALLOCATIONS
+#include "util.hpp"
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+static thread_local uint64_t allocations = 0;
+
+static void *tracked_alloc(size_t size, size_t alignment)
+{
+	++allocations;
+	if (!size)
+		size = 1;
+#ifdef _MSC_VER
+	void *ptr = alignment ? _aligned_malloc(size, alignment) : malloc(size);
+#else
+	/* aligned_alloc wants the size to be a multiple of the alignment */
+	void *ptr = alignment ? aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment) : malloc(size);
+#endif
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+static void tracked_free(void *ptr, bool aligned)
+{
+#ifdef _MSC_VER
+	if (aligned) {
+		_aligned_free(ptr);
+		return;
+	}
+#else
+	UNUSED_PARAMETER(aligned);
+#endif
+	free(ptr);
+}
+
+/* The array and nothrow versions forward to these */
+void *operator new(size_t size)
+{
+	return tracked_alloc(size, 0);
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+	return tracked_alloc(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void *ptr) noexcept
+{
+	tracked_free(ptr, false);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	tracked_free(ptr, false);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+	tracked_free(ptr, true);
+}
+
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept
+{
+	tracked_free(ptr, true);
+}
+
+namespace util {
+
+uint64_t thread_allocations()
+{
+	return allocations;
+}
+
+no_alloc_scope::no_alloc_scope(const char *name, bool armed) : m_name(name), m_start(allocations), m_armed(armed) {}
+
+no_alloc_scope::~no_alloc_scope()
+{
+	if (!m_armed || allocations == m_start)
+		return;
+	warn("%s allocated %llu time(s) after warming up", m_name,
+		 static_cast<unsigned long long>(allocations - m_start));
+	assert(allocations == m_start);
+}
+
+}
+#endif
@@ -0,0 +1,51 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <cstdint>
+
+/* With SPECTRALIZER_TRACK_ALLOCATIONS set, operator new counts allocations
+ * per thread, so that the per frame paths can check they stay off the heap
+ * once warmed up. Allocations obs makes with bmalloc aren't counted */
+namespace util {
+
+#ifdef SPECTRALIZER_TRACK_ALLOCATIONS
+/* Allocations the calling thread has made so far */
+uint64_t thread_allocations();
+
+/* Complains (and asserts in debug builds) if the thread allocated
+ * while this was alive, does nothing unless armed */
+class no_alloc_scope {
+	const char *m_name;
+	uint64_t m_start;
+	bool m_armed;
+
+public:
+	no_alloc_scope(const char *name, bool armed);
+	~no_alloc_scope();
+	no_alloc_scope(const no_alloc_scope &) = delete;
+	no_alloc_scope &operator=(const no_alloc_scope &) = delete;
+};
+#else
+class no_alloc_scope {
+public:
+	no_alloc_scope(const char *, bool) {}
+};
+#endif
+
+}
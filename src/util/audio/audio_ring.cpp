@@ -0,0 +1,104 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "audio_ring.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace audio {
+
+audio_ring::audio_ring(size_t capacity)
+{
+	m_capacity = 1;
+	while (m_capacity < capacity)
+		m_capacity <<= 1;
+	m_mask = m_capacity - 1;
+
+	for (auto &channel : m_data)
+		channel = new float[m_capacity]();
+}
+
+audio_ring::~audio_ring()
+{
+	for (auto &channel : m_data)
+		delete[] channel;
+}
+
+size_t audio_ring::available() const
+{
+	return m_write.load(std::memory_order_acquire) - m_read.load(std::memory_order_acquire);
+}
+
+bool audio_ring::push(const float *const *data, size_t channels, size_t frames)
+{
+	const auto write = m_write.load(std::memory_order_relaxed);
+	const auto read = m_read.load(std::memory_order_acquire);
+
+	if (m_capacity - (write - read) < frames) {
+		m_overruns.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	/* The chunk might wrap around the end of the buffer */
+	const auto start = write & m_mask;
+	const auto first = std::min(frames, m_capacity - start);
+
+	for (size_t i = 0; i < std::min<size_t>(channels, AUDIO_RING_CHANNELS); i++) {
+		if (data && data[i]) {
+			memcpy(m_data[i] + start, data[i], first * sizeof(float));
+			memcpy(m_data[i], data[i] + first, (frames - first) * sizeof(float));
+		} else {
+			memset(m_data[i] + start, 0, first * sizeof(float));
+			memset(m_data[i], 0, (frames - first) * sizeof(float));
+		}
+	}
+
+	m_write.store(write + frames, std::memory_order_release);
+	return true;
+}
+
+bool audio_ring::pop(float *const *out, size_t channels, size_t frames)
+{
+	const auto read = m_read.load(std::memory_order_relaxed);
+	const auto write = m_write.load(std::memory_order_acquire);
+
+	if (write - read < frames) {
+		m_underruns.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	const auto start = read & m_mask;
+	const auto first = std::min(frames, m_capacity - start);
+
+	for (size_t i = 0; i < std::min<size_t>(channels, AUDIO_RING_CHANNELS); i++) {
+		memcpy(out[i], m_data[i] + start, first * sizeof(float));
+		memcpy(out[i] + first, m_data[i], (frames - first) * sizeof(float));
+	}
+
+	m_read.store(read + frames, std::memory_order_release);
+	return true;
+}
+
+void audio_ring::skip(size_t frames)
+{
+	const auto read = m_read.load(std::memory_order_relaxed);
+	const auto write = m_write.load(std::memory_order_acquire);
+	m_read.store(read + std::min(frames, write - read), std::memory_order_release);
+}
+
+}
@@ -0,0 +1,72 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "../core.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#define AUDIO_RING_CHANNELS 2
+
+namespace audio {
+
+/* Wait free single producer/single consumer ring buffer for planar float
+ * audio. The obs audio thread pushes, the thread doing the analysis pops,
+ * neither ever blocks the other. Read and write index are kept on separate
+ * cache lines, so the two threads don't keep stealing the line from each other */
+class audio_ring {
+	float *m_data[AUDIO_RING_CHANNELS] = {};
+	size_t m_capacity = 0, m_mask = 0;
+
+	/* Producer side */
+	std::atomic<size_t> m_write{0};
+	std::atomic<uint64_t> m_overruns{0};
+	char m_pad0[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>) - sizeof(std::atomic<uint64_t>)];
+
+	/* Consumer side */
+	std::atomic<size_t> m_read{0};
+	std::atomic<uint64_t> m_underruns{0};
+	char m_pad1[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>) - sizeof(std::atomic<uint64_t>)];
+
+public:
+	/* Capacity in frames, rounded up to a power of two */
+	explicit audio_ring(size_t capacity);
+	~audio_ring();
+
+	audio_ring(const audio_ring &) = delete;
+	audio_ring &operator=(const audio_ring &) = delete;
+
+	/* Producer: appends frames of each channel, or silence if data is null.
+	 * Drops the whole chunk and counts an overrun if there's no space */
+	bool push(const float *const *data, size_t channels, size_t frames);
+
+	/* Consumer: copies the oldest frames into out, counts an underrun
+	 * and leaves out untouched if there aren't enough */
+	bool pop(float *const *out, size_t channels, size_t frames);
+
+	/* Consumer: throws away the oldest frames to keep latency down */
+	void skip(size_t frames);
+
+	size_t available() const;
+	size_t capacity() const { return m_capacity; }
+	uint64_t overruns() const { return m_overruns.load(std::memory_order_relaxed); }
+	uint64_t underruns() const { return m_underruns.load(std::memory_order_relaxed); }
+};
+
+}
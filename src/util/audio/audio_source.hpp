@@ -17,6 +17,7 @@
  *************************************************************************/
 
 #pragma once
+#include <cstdint>
 
 #define BUFFER_SIZE 1024
 
@@ -25,6 +26,16 @@ struct config;
 }
 
 namespace audio {
+struct spectrum;
+
+/* Told by event driven sources whenever audio was captured,
+ * called on the audio thread so it must never block */
+class audio_listener {
+public:
+	virtual ~audio_listener() {}
+	virtual void audio_arrived() = 0;
+};
+
 /* Base class for audio reading */
 class audio_source {
 protected:
@@ -38,5 +49,16 @@ public:
 	/* obs_source methods */
 	virtual void update() = 0;
 	virtual bool tick(float seconds) = 0;
+
+	/* Sources that tell config::listener whenever audio arrives
+	 * can drive analysis on the thread pool, all others are polled */
+	virtual bool event_driven() const { return false; }
+	/* True if the next tick would get a full buffer */
+	virtual bool audio_ready() const { return false; }
+	/* Sources that share one analysis between visualizers hand over
+	 * the finished spectrum instead of filling config::buffer */
+	virtual const spectrum *shared_spectrum() const { return nullptr; }
+	/* Changes whenever another visualizer reconfigures the shared analysis */
+	virtual uint64_t revision() const { return 0; }
 };
 }
@@ -21,6 +21,7 @@
 #include "audio_source.hpp"
 #include "fifo.hpp"
 #include "obs_internal_source.hpp"
+#include "replay.hpp"
 
 namespace audio {
 
@@ -37,6 +38,7 @@ audio_visualizer::~audio_visualizer()
 
 void audio_visualizer::update()
 {
+	m_ticks_since_update = 0;
 	if (m_source)
 		m_source->update();
 	if (!m_source || m_cfg->audio_source_name != m_source_id) {
@@ -47,14 +49,37 @@ void audio_visualizer::update()
 			m_source = nullptr;
 		} else if (m_cfg->audio_source_name == std::string("mpd")) {
 			m_source = new fifo(m_cfg);
+		} else if (m_cfg->audio_source_name == std::string("replay")) {
+			m_source = new replay(m_cfg);
 		} else {
 			m_source = new obs_internal_source(m_cfg);
 		}
 	}
 }
 
+bool audio_visualizer::event_driven() const
+{
+	return m_source && m_source->event_driven();
+}
+
+bool audio_visualizer::audio_ready() const
+{
+	return m_source && m_source->audio_ready();
+}
+
+bool audio_visualizer::source_changed() const
+{
+	return m_source && m_source->revision() != m_source_revision;
+}
+
 void audio_visualizer::tick(float seconds)
 {
+	if (source_changed()) {
+		m_source_revision = m_source->revision();
+		m_ticks_since_update = 0;
+	}
+	if (m_ticks_since_update < constants::alloc_warmup_ticks)
+		++m_ticks_since_update;
 	if (m_source)
 		m_data_read = m_source->tick(seconds);
 	else
@@ -63,7 +88,8 @@ void audio_visualizer::tick(float seconds)
 #ifdef LINUX
 	if (m_cfg->auto_clear && !m_data_read) {
 		/* Clear buffer */
-		memset(m_cfg->buffer, 0, m_cfg->sample_size * sizeof(pcm_stereo_sample));
+		for (auto &buf : m_cfg->buffer)
+			memset(buf, 0, m_cfg->sample_size * sizeof(float));
 	}
 #endif
 }
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include "../util.hpp"
+#include <atomic>
 #include <graphics/graphics.h>
 #include <string>
 
@@ -34,6 +36,8 @@ protected:
 	source::config *m_cfg = nullptr;
 	std::string m_source_id = "none"; /* where to read audio from */
 	bool m_data_read = false;         /* Audio source will return false if reading failed */
+	std::atomic<uint32_t> m_ticks_since_update{0};
+	uint64_t m_source_revision = 0;
 
 public:
 	audio_visualizer(source::config *cfg);
@@ -45,6 +49,17 @@ public:
      * user configured fps */
 	virtual void tick(float seconds);
 
-	virtual void render(gs_effect_t *effect) = 0;
+	bool event_driven() const;
+	bool audio_ready() const;
+	/* Buffers have reached their final size a few ticks after update(),
+	 * from then on tick() and render() shouldn't allocate anymore */
+	bool warmed_up() const { return m_ticks_since_update >= constants::alloc_warmup_ticks; }
+	/* A shared source was reconfigured by another visualizer since the last
+	 * tick, which restarts the warm-up. Only valid on the analysis thread */
+	bool source_changed() const;
+
+	/* Called on the graphics thread with its own settings snapshot,
+	 * which can be newer than m_cfg */
+	virtual void render(gs_effect_t *effect, const source::config *cfg) = 0;
 };
 }
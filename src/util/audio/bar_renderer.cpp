@@ -0,0 +1,62 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "bar_renderer.hpp"
+
+namespace audio {
+
+void bar_renderer::reserve(render_backend &backend, size_t vertices)
+{
+	if (m_vertices.size() < vertices)
+		m_vertices.resize(vertices);
+	if (m_buffer_vertices >= vertices)
+		return;
+
+	backend.destroy_vertex_buffer(m_buffer);
+	m_buffer = backend.create_vertex_buffer(vertices);
+	m_buffer_vertices = m_buffer ? vertices : 0;
+}
+
+void bar_renderer::render(render_backend &backend, const bar_layout &layout, const realv &left, const realv &right,
+						  util::stage_profile *profile)
+{
+	util::stage_timer timer(profile, util::PS_VERTICES);
+
+	size_t left_count = 0, right_count = 0;
+	if (layout.stereo) {
+		/* The frame can still be mono if stereo was just turned on */
+		size_t count = UTIL_MIN(left.size(), right.size());
+		reserve(backend, bar_vertex_count(count) * 2);
+		left_count = build_bar_vertices(left.data(), count, layout, CM_LEFT, m_vertices.data());
+		right_count = build_bar_vertices(right.data(), count, layout, CM_RIGHT, m_vertices.data() + left_count);
+	} else {
+		reserve(backend, bar_vertex_count(left.size()));
+		left_count = build_bar_vertices(left.data(), left.size(), layout, CM_BOTH, m_vertices.data());
+	}
+	timer.stop();
+
+	if (!left_count || !m_buffer)
+		return;
+
+	backend.upload(m_buffer, m_vertices.data(), left_count + right_count);
+	backend.draw(m_buffer, DM_TRIS, 0, left_count);
+	if (right_count)
+		backend.draw(m_buffer, DM_TRIS, left_count, right_count);
+}
+
+}
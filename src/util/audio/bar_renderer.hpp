@@ -0,0 +1,40 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "../profiler.hpp"
+#include "render_backend.hpp"
+
+namespace audio {
+
+/* Builds all bars of a frame into one buffer and draws them with a single
+ * call per channel. The buffer only grows, so it's made once per bar count */
+class bar_renderer {
+	vertexv m_vertices;
+	vertex_buffer m_buffer = 0;
+	size_t m_buffer_vertices = 0;
+
+	void reserve(render_backend &backend, size_t vertices);
+
+public:
+	/* right is only drawn in stereo, vertex generation is timed as PS_VERTICES */
+	void render(render_backend &backend, const bar_layout &layout, const realv &left, const realv &right,
+				util::stage_profile *profile = nullptr);
+};
+
+}
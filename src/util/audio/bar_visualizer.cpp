@@ -23,52 +23,18 @@ namespace audio {
 
 bar_visualizer::bar_visualizer(source::config *cfg) : spectrum_visualizer(cfg) {}
 
-void bar_visualizer::render(gs_effect_t *effect)
+void bar_visualizer::render(gs_effect_t *effect, const source::config *cfg)
 {
-	if (m_cfg->stereo) {
-		size_t i = 0, pos_x = 0;
-		uint32_t height_l, height_r;
-		uint offset = m_cfg->stereo_space / 2;
-		uint center = m_cfg->bar_height / 2 + offset;
+	const auto &frame = acquire_frame();
 
-		/* Just in case */
-		if (m_bars_left.size() != m_cfg->detail + DEAD_BAR_OFFSET)
-			m_bars_left.resize(m_cfg->detail + DEAD_BAR_OFFSET, 0.0);
-		if (m_bars_right.size() != m_cfg->detail + DEAD_BAR_OFFSET)
-			m_bars_right.resize(m_cfg->detail + DEAD_BAR_OFFSET, 0.0);
+	bar_layout layout;
+	layout.bar_width = cfg->bar_width;
+	layout.bar_space = cfg->bar_space;
+	layout.bar_height = cfg->bar_height;
+	layout.stereo_space = cfg->stereo_space;
+	layout.stereo = cfg->stereo;
 
-		for (; i < m_bars_left.size() - DEAD_BAR_OFFSET; i++) { /* Leave the four dead bars the end */
-			height_l = UTIL_MAX(static_cast<uint32_t>(round(m_bars_left[i])), 1);
-			height_r = UTIL_MAX(static_cast<uint32_t>(round(m_bars_right[i])), 1);
-
-			pos_x = i * (m_cfg->bar_width + m_cfg->bar_space);
-
-			/* Top */
-			gs_matrix_push();
-			gs_matrix_translate3f(pos_x, (center - height_l) - offset, 0);
-			gs_draw_sprite(nullptr, 0, m_cfg->bar_width, height_l);
-			gs_matrix_pop();
-
-			/* Bottom */
-			gs_matrix_push();
-			gs_matrix_translate3f(pos_x, center + offset, 0);
-			gs_draw_sprite(nullptr, 0, m_cfg->bar_width, height_r);
-			gs_matrix_pop();
-		}
-	} else {
-		size_t i = 0, pos_x = 0;
-		uint32_t height;
-		for (; i < m_bars_left.size() - DEAD_BAR_OFFSET; i++) { /* Leave the four dead bars the end */
-			auto val = m_bars_left[i];
-			height = UTIL_MAX(static_cast<uint32_t>(round(val)), 1);
-
-			pos_x = i * (m_cfg->bar_width + m_cfg->bar_space);
-			gs_matrix_push();
-			gs_matrix_translate3f(pos_x, (m_cfg->bar_height - height), 0);
-			gs_draw_sprite(nullptr, 0, m_cfg->bar_width, height);
-			gs_matrix_pop();
-		}
-	}
+	m_renderer.render(m_backend, layout, frame.left, frame.right, &profile());
 	UNUSED_PARAMETER(effect);
 }
 }
@@ -17,12 +17,18 @@
  *************************************************************************/
 
 #pragma once
+#include "bar_renderer.hpp"
+#include "obs_render_backend.hpp"
 #include "spectrum_visualizer.hpp"
 
 namespace audio {
 class bar_visualizer : public spectrum_visualizer {
+	/* Only touched by render(), the backend owns the renderer's buffers */
+	obs_render_backend m_backend;
+	bar_renderer m_renderer;
+
 public:
 	explicit bar_visualizer(source::config *cfg);
-	void render(gs_effect_t *effect) override;
+	void render(gs_effect_t *effect, const source::config *cfg) override;
 };
 }
@@ -0,0 +1,248 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "capture_hub.hpp"
+#include <util/bmem.h>
+#include <util/platform.h>
+
+#define RECONNECT_NS 3000000000ULL
+
+namespace audio {
+
+static std::mutex hub_mutex; /* Guards hubs, always taken before a hub's own mutex */
+static std::map<std::string, capture_hub *> hubs;
+
+static void audio_capture(void *param, obs_source_t *, const struct audio_data *data, bool muted)
+{
+	auto *hub = reinterpret_cast<capture_hub *>(param);
+	if (hub)
+		hub->capture(data, muted);
+}
+
+capture_hub::capture_hub(const std::string &name) : m_name(name), m_audio_data(constants::audio_ring_frames)
+{
+	/* Same as obs_internal_source::update(), sample rates are divided by 60
+	 * regardless of the frame rate */
+	m_sample_size = audio_output_get_sample_rate(obs_get_audio()) / 60;
+	m_num_channels = audio_output_get_channels(obs_get_audio());
+
+	for (auto &pcm : m_pcm)
+		pcm = static_cast<float *>(bzalloc(m_sample_size * sizeof(float)));
+
+	m_listeners.publish(new std::vector<audio_listener *>());
+	m_capture_check_time = os_gettime_ns() - RECONNECT_NS;
+	connect();
+}
+
+capture_hub::~capture_hub()
+{
+	if (m_capture_source) {
+		obs_source_t *source = obs_weak_source_get_source(m_capture_source);
+		if (source) {
+			info("Removed audio capture from '%s'", obs_source_get_name(source));
+			obs_source_remove_audio_capture_callback(source, audio_capture, this);
+			obs_source_release(source);
+		}
+		obs_weak_source_release(m_capture_source);
+	}
+
+	if (m_audio_data.overruns() || m_audio_data.underruns())
+		info("Audio capture of '%s' had %llu overrun(s) and %llu underrun(s)", m_name.c_str(),
+			 static_cast<unsigned long long>(m_audio_data.overruns()),
+			 static_cast<unsigned long long>(m_audio_data.underruns()));
+	if (m_analyses)
+		debug("Audio of '%s' was analyzed %llu times for %llu reads", m_name.c_str(),
+			  static_cast<unsigned long long>(m_analyses), static_cast<unsigned long long>(m_reads));
+
+	m_listeners.publish(nullptr);
+	for (auto &pcm : m_pcm)
+		bfree(pcm);
+}
+
+capture_hub *capture_hub::subscribe(const std::string &name, const subscriber &sub, size_t *id)
+{
+	std::lock_guard<std::mutex> lock(hub_mutex);
+	auto &hub = hubs[name];
+	if (!hub)
+		hub = new capture_hub(name);
+
+	{
+		std::lock_guard<std::mutex> hub_lock(hub->m_mutex);
+		*id = hub->m_next_id++;
+		hub->m_subscribers[*id] = sub;
+		hub->reconfigure();
+		hub->publish_listeners();
+	}
+	return hub;
+}
+
+void capture_hub::unsubscribe(capture_hub *hub, size_t id)
+{
+	std::lock_guard<std::mutex> lock(hub_mutex);
+	bool last;
+
+	{
+		std::lock_guard<std::mutex> hub_lock(hub->m_mutex);
+		hub->m_subscribers.erase(id);
+		last = hub->m_subscribers.empty();
+		if (!last)
+			hub->reconfigure();
+		hub->publish_listeners();
+	}
+
+	/* The listener is about to be deleted, so wait
+	 * for the audio thread to let go of the old list */
+	hub->m_listeners.synchronize();
+
+	if (last) {
+		hubs.erase(hub->m_name);
+		delete hub;
+	}
+}
+
+void capture_hub::update(size_t id, const subscriber &sub)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_subscribers.find(id);
+	if (it == m_subscribers.end())
+		return;
+	it->second = sub;
+	reconfigure();
+	publish_listeners();
+}
+
+void capture_hub::publish_listeners()
+{
+	auto *listeners = new std::vector<audio_listener *>();
+	for (const auto &sub : m_subscribers) {
+		if (sub.second.listener)
+			listeners->emplace_back(sub.second.listener);
+	}
+	m_listeners.publish(listeners);
+}
+
+void capture_hub::connect()
+{
+	if (m_capture_source)
+		return;
+
+	uint64_t t = os_gettime_ns();
+	if (t - m_capture_check_time <= RECONNECT_NS)
+		return;
+	m_capture_check_time = t;
+
+	obs_source_t *capture = obs_get_source_by_name(m_name.c_str());
+	if (capture) {
+		info("Added audio capture to '%s'", obs_source_get_name(capture));
+		m_capture_source = obs_source_get_weak_source(capture);
+		obs_source_add_audio_capture_callback(capture, audio_capture, this);
+		obs_source_release(capture);
+	}
+}
+
+void capture_hub::reconfigure()
+{
+	/* Analyze in stereo if anyone needs it, packing is only used if every
+	 * stereo subscriber allows it and plans get the highest rigor asked for */
+	bool stereo = false, packed = true;
+	fft_rigor rigor = FR_ESTIMATE;
+
+	for (const auto &it : m_subscribers) {
+		const auto &sub = it.second;
+		if (sub.stereo) {
+			stereo = true;
+			packed = packed && sub.packed;
+		}
+		rigor = UTIL_MAX(rigor, sub.rigor);
+	}
+
+	m_fft.configure(m_sample_size, stereo, packed, rigor);
+	++m_revision;
+}
+
+bool capture_hub::analyze()
+{
+	/* The audio thread can't drop old data,
+	 * so keep latency down by skipping it here instead */
+	size_t expected = m_max_capture_frames;
+	if (expected && m_audio_data.available() > expected * 2)
+		m_audio_data.skip(expected);
+
+	const size_t channels = UTIL_MIN(m_num_channels.load(), AUDIO_RING_CHANNELS);
+	if (!m_audio_data.pop(m_pcm, channels, m_sample_size))
+		return false;
+
+	if (!m_fft.process(m_pcm[0], m_pcm[1]))
+		return false;
+
+	++m_sequence;
+	++m_analyses;
+	return true;
+}
+
+bool capture_hub::read(spectrum *out)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	connect();
+
+	/* Whoever asks first after new audio arrived does the analysis,
+	 * everyone else just gets a copy of its result */
+	if (out->sequence == m_sequence && !analyze())
+		return false;
+
+	const auto &result = m_fft.result();
+	out->sequence = m_sequence;
+	out->left = result.left;
+	out->right = result.right;
+	out->stats_left = result.stats_left;
+	out->stats_right = result.stats_right;
+	++m_reads;
+	return true;
+}
+
+bool capture_hub::ready(uint64_t sequence) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_sequence > sequence || m_audio_data.available() >= m_sample_size;
+}
+
+void capture_hub::capture(const struct audio_data *data, bool muted)
+{
+	/* Runs on the audio thread, which must never wait for the video thread,
+	 * so this only ever touches the producer side of the ring */
+	if (m_max_capture_frames < data->frames)
+		m_max_capture_frames = data->frames;
+
+	const size_t channels = UTIL_MIN(m_num_channels.load(), AUDIO_RING_CHANNELS);
+	const float *planes[AUDIO_RING_CHANNELS] = {};
+
+	if (!muted) {
+		for (size_t i = 0; i < channels; i++)
+			planes[i] = reinterpret_cast<const float *>(data->data[i]);
+	}
+
+	m_audio_data.push(planes, channels, data->frames);
+
+	util::snapshot_cell<const std::vector<audio_listener *>, 1>::reader listeners(m_listeners, 0);
+	if (listeners) {
+		for (auto *listener : *listeners.get())
+			listener->audio_arrived();
+	}
+}
+
+}
@@ -0,0 +1,92 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "../snapshot.hpp"
+#include "audio_ring.hpp"
+#include "audio_source.hpp"
+#include "fft_stage.hpp"
+#include <map>
+#include <media-io/audio-io.h>
+#include <mutex>
+#include <obs-module.h>
+#include <string>
+
+namespace audio {
+
+/* One audio capture per obs source, shared by every visualizer listening
+ * to it. Registers a single capture callback, analyzes each sample_size
+ * frames once and hands copies of the spectrum to all subscribers, which
+ * only do their own binning, smoothing and drawing */
+class capture_hub {
+public:
+	struct subscriber {
+		audio_listener *listener = nullptr;
+		bool stereo = false;
+		bool packed = true;
+		fft_rigor rigor = FR_ESTIMATE;
+	};
+
+private:
+	std::string m_name;
+	mutable std::mutex m_mutex; /* Guards everything except the ring and listeners */
+	std::map<size_t, subscriber> m_subscribers;
+	size_t m_next_id = 0;
+	std::atomic<uint64_t> m_revision{0}; /* Bumped by reconfigure() */
+
+	obs_weak_source_t *m_capture_source = nullptr;
+	uint64_t m_capture_check_time = 0;
+	uint32_t m_sample_size = 0;
+
+	/* Touched by the audio thread */
+	std::atomic<size_t> m_max_capture_frames{0};
+	std::atomic<uint8_t> m_num_channels{0};
+	audio_ring m_audio_data;
+	util::snapshot_cell<const std::vector<audio_listener *>, 1> m_listeners;
+
+	float *m_pcm[AUDIO_RING_CHANNELS] = {};
+	fft_stage m_fft;
+	uint64_t m_sequence = 0; /* Of the spectrum in m_fft */
+	uint64_t m_analyses = 0, m_reads = 0;
+
+	explicit capture_hub(const std::string &name);
+	~capture_hub();
+
+	void connect();
+	void publish_listeners();
+	/* Called whenever subscribers change, so that read() never has to */
+	void reconfigure();
+	bool analyze();
+
+public:
+	/* Refcounted through the subscribers, the last one to leave deletes the hub */
+	static capture_hub *subscribe(const std::string &name, const subscriber &sub, size_t *id);
+	static void unsubscribe(capture_hub *hub, size_t id);
+	void update(size_t id, const subscriber &sub);
+
+	/* Copies the newest spectrum into out, analyzing new audio first if
+	 * out already holds the newest one. False if there was nothing new */
+	bool read(spectrum *out);
+	/* True if read() would return something newer than sequence */
+	bool ready(uint64_t sequence) const;
+	uint64_t revision() const { return m_revision; }
+
+	void capture(const struct audio_data *data, bool muted);
+};
+
+}
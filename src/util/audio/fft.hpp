@@ -0,0 +1,106 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include <fftw3.h>
+#include <vector>
+
+namespace audio {
+
+/* Thin layer over the parts of the fftw api that are used, so the
+ * precision of the whole spectrum pipeline can be picked at compile time.
+ * 16 bit input and a few hundred pixels of output don't need doubles,
+ * so building with SPECTRALIZER_FLOAT_FFT uses fftwf and float buffers */
+template<class T> struct fft_api;
+
+template<> struct fft_api<double> {
+	using complex = fftw_complex;
+	using plan = fftw_plan;
+	static constexpr const char *wisdom_file = "fftw_wisdom.txt";
+
+	static plan plan_r2c(int n, double *in, complex *out, unsigned flags)
+	{
+		return fftw_plan_dft_r2c_1d(n, in, out, flags);
+	}
+
+	static plan plan_many_r2c(int n, int howmany, double *in, complex *out, unsigned flags)
+	{
+		return fftw_plan_many_dft_r2c(1, &n, howmany, in, nullptr, 1, n, out, nullptr, 1, n / 2 + 1, flags);
+	}
+
+	static plan plan_c2c(int n, complex *in, complex *out, unsigned flags)
+	{
+		return fftw_plan_dft_1d(n, in, out, FFTW_FORWARD, flags);
+	}
+
+	static void execute(plan p, double *in, complex *out) { fftw_execute_dft_r2c(p, in, out); }
+	static void execute_c2c(plan p, complex *in, complex *out) { fftw_execute_dft(p, in, out); }
+	static void destroy(plan p) { fftw_destroy_plan(p); }
+	static int alignment_of(double *p) { return fftw_alignment_of(p); }
+	static void *malloc(size_t n) { return fftw_malloc(n); }
+	static void free(void *p) { fftw_free(p); }
+	static void set_timelimit(double t) { fftw_set_timelimit(t); }
+	static int import_wisdom(const char *path) { return fftw_import_wisdom_from_filename(path); }
+	static int export_wisdom(const char *path) { return fftw_export_wisdom_to_filename(path); }
+	static void cleanup() { fftw_cleanup(); }
+};
+
+template<> struct fft_api<float> {
+	using complex = fftwf_complex;
+	using plan = fftwf_plan;
+	static constexpr const char *wisdom_file = "fftwf_wisdom.txt";
+
+	static plan plan_r2c(int n, float *in, complex *out, unsigned flags)
+	{
+		return fftwf_plan_dft_r2c_1d(n, in, out, flags);
+	}
+
+	static plan plan_many_r2c(int n, int howmany, float *in, complex *out, unsigned flags)
+	{
+		return fftwf_plan_many_dft_r2c(1, &n, howmany, in, nullptr, 1, n, out, nullptr, 1, n / 2 + 1, flags);
+	}
+
+	static plan plan_c2c(int n, complex *in, complex *out, unsigned flags)
+	{
+		return fftwf_plan_dft_1d(n, in, out, FFTW_FORWARD, flags);
+	}
+
+	static void execute(plan p, float *in, complex *out) { fftwf_execute_dft_r2c(p, in, out); }
+	static void execute_c2c(plan p, complex *in, complex *out) { fftwf_execute_dft(p, in, out); }
+	static void destroy(plan p) { fftwf_destroy_plan(p); }
+	static int alignment_of(float *p) { return fftwf_alignment_of(p); }
+	static void *malloc(size_t n) { return fftwf_malloc(n); }
+	static void free(void *p) { fftwf_free(p); }
+	static void set_timelimit(double t) { fftwf_set_timelimit(t); }
+	static int import_wisdom(const char *path) { return fftwf_import_wisdom_from_filename(path); }
+	static int export_wisdom(const char *path) { return fftwf_export_wisdom_to_filename(path); }
+	static void cleanup() { fftwf_cleanup(); }
+};
+
+#ifdef SPECTRALIZER_FLOAT_FFT
+using fft_real = float;
+#else
+using fft_real = double;
+#endif
+
+using fft = fft_api<fft_real>;
+using fft_complex = fft::complex;
+using fft_plan = fft::plan;
+using realv = std::vector<fft_real>;
+
+}
@@ -0,0 +1,257 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "fft_plan_cache.hpp"
+#include "fft_wisdom.hpp"
+#include <chrono>
+#include <tuple>
+
+namespace audio {
+
+std::mutex &planner_mutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+/* Plans retired by the last fft_plan_ref, shared by all caches */
+static std::mutex retired_mutex;
+static std::vector<fft_plan> retired;
+
+static void retire_plan(fft_plan plan)
+{
+	std::lock_guard<std::mutex> lock(retired_mutex);
+	retired.emplace_back(plan);
+}
+
+void destroy_retired_plans(bool wait)
+{
+	{
+		std::lock_guard<std::mutex> lock(retired_mutex);
+		if (retired.empty())
+			return;
+	}
+
+	std::unique_lock<std::mutex> planner_lock(planner_mutex(), std::defer_lock);
+	if (wait)
+		planner_lock.lock();
+	else if (!planner_lock.try_lock())
+		return;
+
+	std::lock_guard<std::mutex> lock(retired_mutex);
+	for (auto &plan : retired)
+		fft::destroy(plan);
+	retired.clear();
+}
+
+bool fft_plan_key::operator<(const fft_plan_key &o) const
+{
+	return std::tie(sample_size, in_alignment, out_alignment, channels, packed) <
+		   std::tie(o.sample_size, o.in_alignment, o.out_alignment, o.channels, o.packed);
+}
+
+fft_plan_cache::~fft_plan_cache()
+{
+	/* The plan that's being measured is finished, so it ends up in
+	 * the wisdom, anything still queued is dropped */
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	m_idle.notify_all();
+	if (m_worker.joinable())
+		m_worker.join();
+	clear();
+}
+
+fft_plan fft_plan_cache::make_plan(const fft_plan_key &key, unsigned flags)
+{
+	if (key.sample_size < 1 || key.channels < 1)
+		return nullptr;
+
+	const auto n = static_cast<int>(key.sample_size);
+	const auto results = static_cast<int>(key.sample_size / 2 + 1);
+
+	/* fftw_malloc is SIMD aligned, so offsetting by the wanted alignment
+	 * gives scratch buffers that look like the visualizer's buffers */
+	auto *in_mem = static_cast<char *>(fft::malloc(sizeof(fft_real) * n * key.channels + 64));
+	auto *out_mem = static_cast<char *>(fft::malloc(sizeof(fft_complex) * results * key.channels + 64));
+	auto *in = reinterpret_cast<fft_real *>(in_mem + key.in_alignment);
+	auto *out = reinterpret_cast<fft_complex *>(out_mem + key.out_alignment);
+	fft_plan plan;
+
+	auto start = std::chrono::steady_clock::now();
+	fft::set_timelimit(flags & FFTW_ESTIMATE ? FFTW_NO_TIMELIMIT : constants::fft_plan_time_limit);
+	if (key.packed)
+		plan = fft::plan_c2c(n, reinterpret_cast<fft_complex *>(in), out, flags);
+	else if (key.channels == 1)
+		plan = fft::plan_r2c(n, in, out, flags);
+	else
+		plan = fft::plan_many_r2c(n, static_cast<int>(key.channels), in, out, flags);
+	fft::set_timelimit(FFTW_NO_TIMELIMIT);
+	auto elapsed = std::chrono::steady_clock::now() - start;
+
+	fft::free(in_mem);
+	fft::free(out_mem);
+
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	m_plan_ns += ns;
+
+	if (!plan) {
+		warn("Failed to create fft plan for %u samples", key.sample_size);
+	} else if (!(flags & FFTW_ESTIMATE)) {
+		info("Measured fft plan for %u samples, %u channel(s) in %.2f ms (%s wisdom)", key.sample_size,
+			 key.channels, ns / 1000000.0, wisdom::is_warm() ? "warm" : "cold");
+	}
+	return plan;
+}
+
+void fft_plan_cache::store(const fft_plan_key &key, fft_plan plan, bool upgrade)
+{
+	auto &entry = m_plans[key];
+	if (!entry || upgrade) {
+		/* Sources still executing the old plan keep it alive */
+		if (entry)
+			++m_upgrades;
+		entry = fft_plan_ref(plan, retire_plan);
+	} else {
+		/* Another estimate got here first */
+		retire_plan(plan);
+	}
+}
+
+void fft_plan_cache::queue(const fft_plan_key &key, unsigned flags)
+{
+	for (const auto &job : m_jobs) {
+		if (job.flags == flags && !(job.key < key) && !(key < job.key))
+			return;
+	}
+
+	if (flags == FFTW_ESTIMATE)
+		m_jobs.push_front({key, flags});
+	else
+		m_jobs.push_back({key, flags});
+
+	if (!m_worker.joinable())
+		m_worker = std::thread(&fft_plan_cache::work, this);
+	m_wake.notify_one();
+}
+
+void fft_plan_cache::work()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		m_wake.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+		if (m_stop)
+			break;
+
+		auto job = m_jobs.front();
+		m_jobs.pop_front();
+		auto upgrade = job.flags != FFTW_ESTIMATE;
+		if (upgrade || !m_plans.count(job.key)) {
+			m_busy = true;
+			lock.unlock();
+
+			fft_plan plan;
+			{
+				std::lock_guard<std::mutex> planner_lock(planner_mutex());
+				plan = make_plan(job.key, job.flags);
+			}
+
+			lock.lock();
+			m_busy = false;
+			if (plan)
+				store(job.key, plan, upgrade);
+		}
+		destroy_retired_plans();
+
+		if (m_jobs.empty())
+			m_idle.notify_all();
+	}
+}
+
+fft_plan_ref fft_plan_cache::estimate(const fft_plan_key &key)
+{
+	std::unique_lock<std::mutex> planner_lock(planner_mutex(), std::try_to_lock);
+	if (!planner_lock.owns_lock()) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		queue(key, FFTW_ESTIMATE);
+		return nullptr;
+	}
+
+	auto plan = make_plan(key, FFTW_ESTIMATE);
+	planner_lock.unlock();
+	if (!plan)
+		return nullptr;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	store(key, plan, false);
+	return m_plans[key];
+}
+
+fft_plan_ref fft_plan_cache::get(const fft_plan_key &key)
+{
+	/* Don't stall the video thread if another cache is busy measuring,
+	 * there's always the next tick */
+	destroy_retired_plans();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_plans.find(key);
+		if (it != m_plans.end()) {
+			++m_hits;
+			return it->second;
+		}
+	}
+
+	++m_misses;
+	return estimate(key);
+}
+
+void fft_plan_cache::prepare(const fft_plan_key &key, fft_rigor rigor)
+{
+	get(key);
+	if (rigor == FR_ESTIMATE)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_upgraded.find(key);
+	if (it != m_upgraded.end() && it->second >= rigor)
+		return;
+	m_upgraded[key] = rigor;
+	queue(key, rigor == FR_PATIENT ? FFTW_PATIENT : FFTW_MEASURE);
+}
+
+void fft_plan_cache::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this] { return m_stop || (m_jobs.empty() && !m_busy); });
+}
+
+void fft_plan_cache::clear()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_plans.clear();
+		m_upgraded.clear();
+	}
+	/* Plans still referenced by a source are destroyed on a later call */
+	destroy_retired_plans(true);
+}
+
+}
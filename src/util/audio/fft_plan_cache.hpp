@@ -0,0 +1,114 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "../core.hpp"
+#include "fft.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace audio {
+
+/* Identifies a real to complex plan. Plans are executed with
+ * fftw_execute_dft_r2c on the visualizer's buffers, which is only
+ * valid if they have the same alignment as the arrays the plan was made for */
+struct fft_plan_key {
+	uint32_t sample_size = 0;
+	int in_alignment = 0;
+	int out_alignment = 0;
+	uint32_t channels = 1; /* Channels are stored back to back in one buffer */
+	bool packed = false;   /* Complex to complex plan for two interleaved channels */
+
+	bool operator<(const fft_plan_key &o) const;
+};
+
+/* Plans are handed out by reference count, sources running concurrently
+ * can still be executing a plan after it was upgraded. The last reference
+ * retires the plan, it's destroyed once the fftw planner is free */
+using fft_plan_ref = std::shared_ptr<std::remove_pointer<fft_plan>::type>;
+
+/* Keeps fftw plans alive between ticks, so that planning only happens
+ * when the buffer layout changes. Plans are made with FFTW_ESTIMATE first
+ * and can then be replaced with more rigorous plans on a background thread.
+ * Neither get() nor prepare() ever wait for the fftw planner, if another
+ * plan is being measured the estimate is queued for the background thread */
+class fft_plan_cache {
+	struct plan_job {
+		fft_plan_key key;
+		unsigned flags;
+	};
+
+	std::mutex m_mutex; /* Guards everything below but the counters */
+	std::condition_variable m_wake, m_idle;
+	std::map<fft_plan_key, fft_plan_ref> m_plans;
+	std::map<fft_plan_key, fft_rigor> m_upgraded;
+	std::deque<plan_job> m_jobs; /* Estimates are queued in front of upgrades */
+	std::thread m_worker;        /* Started on the first queued job */
+	bool m_busy = false, m_stop = false;
+	std::atomic<uint64_t> m_hits{0}, m_misses{0}, m_upgrades{0};
+	std::atomic<uint64_t> m_plan_ns{0}; /* Time spent in the fftw planner */
+
+	/* Expects m_mutex to be held */
+	void queue(const fft_plan_key &key, unsigned flags);
+
+	/* Plans right away if the planner is free, otherwise queues it */
+	fft_plan_ref estimate(const fft_plan_key &key);
+	void store(const fft_plan_key &key, fft_plan plan, bool upgrade);
+	void work();
+
+	/* Makes a plan using scratch buffers with the alignment described by key.
+	 * The fftw planner isn't thread safe, so planner_mutex() has to be held */
+	fft_plan make_plan(const fft_plan_key &key, unsigned flags);
+
+public:
+	fft_plan_cache() = default;
+	~fft_plan_cache();
+
+	/* Called from update(): makes sure a plan for this key exists or is
+	 * queued and queues a background upgrade if rigor is above FR_ESTIMATE */
+	void prepare(const fft_plan_key &key, fft_rigor rigor);
+
+	/* Called every tick, null while the plan is still queued. Hold
+	 * on to the reference for as long as the plan is executed */
+	fft_plan_ref get(const fft_plan_key &key);
+
+	/* Blocks until all queued plans are done */
+	void wait();
+
+	void clear();
+
+	uint64_t hits() const { return m_hits; }
+	uint64_t misses() const { return m_misses; }
+	uint64_t upgrades() const { return m_upgrades; }
+	double plan_time_ms() const { return m_plan_ns / 1000000.0; }
+};
+
+/* Has to be held for anything that touches fftw's planner or wisdom */
+std::mutex &planner_mutex();
+
+/* Destroys plans whose last reference is gone, skipped
+ * if the planner is busy unless wait is set */
+void destroy_retired_plans(bool wait = false);
+
+}
@@ -0,0 +1,199 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "fft_stage.hpp"
+#include "fft_wisdom.hpp"
+#include "magnitude.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace audio {
+
+fft_stage::~fft_stage()
+{
+	fft::free(m_input);
+	fft::free(m_output);
+	fft::free(m_packed_output);
+}
+
+void fft_stage::configure(uint32_t sample_size, bool stereo, bool packed, fft_rigor rigor)
+{
+	/* Called on every settings update, which mostly changes things that
+	 * happen after the transform. Keeps the plans and packing validation */
+	if (m_input && sample_size == m_sample_size && stereo == m_stereo && packed == m_packed_requested &&
+		rigor == m_rigor)
+		return;
+
+	m_sample_size = sample_size;
+	m_packed_requested = packed;
+	m_rigor = rigor;
+	m_stereo = stereo;
+	m_results = (size_t)sample_size / 2 + 1;
+	/* fftw has no realloc, the contents don't matter anyways */
+	fft::free(m_input);
+	fft::free(m_output);
+	m_input = static_cast<fft_real *>(fft::malloc(sizeof(fft_real) * sample_size * 2));
+	m_output = static_cast<fft_complex *>(fft::malloc(sizeof(fft_complex) * m_results * 2));
+
+	m_input_left = m_input;
+	m_input_right = m_input + sample_size;
+	m_output_left = m_output;
+	m_output_right = m_output + m_results;
+
+	m_plan_key.sample_size = sample_size;
+	m_plan_key.in_alignment = fft::alignment_of(m_input);
+	m_plan_key.out_alignment = fft::alignment_of(reinterpret_cast<fft_real *>(m_output));
+	m_plan_key.channels = stereo ? 2 : 1;
+
+	auto *cache = wisdom::plan_cache();
+	cache->prepare(m_plan_key, rigor);
+
+	m_packed = stereo && packed;
+	if (m_packed) {
+		fft::free(m_packed_output);
+		m_packed_output = static_cast<fft_complex *>(fft::malloc(sizeof(fft_complex) * sample_size));
+		m_packed_plan_key = m_plan_key;
+		m_packed_plan_key.out_alignment = fft::alignment_of(reinterpret_cast<fft_real *>(m_packed_output));
+		m_packed_plan_key.packed = true;
+		cache->prepare(m_packed_plan_key, rigor);
+
+		/* Validated once the plans are there, the planner might be busy */
+		m_packing_checked = false;
+		m_packing_scratch.resize(m_results * 4 + (size_t)sample_size * 2);
+	}
+
+	m_spectrum.left.assign(m_results, 0);
+	if (stereo)
+		m_spectrum.right.assign(m_results, 0);
+	else
+		m_spectrum.right.clear();
+
+	info("FFT plan cache: %llu hits, %llu misses, %llu upgrades", (unsigned long long)cache->hits(),
+		 (unsigned long long)cache->misses(), (unsigned long long)cache->upgrades());
+}
+
+bool fft_stage::process(const float *in_left, const float *in_right, util::stage_profile *profile)
+{
+	if (!m_sample_size)
+		return false;
+
+	util::stage_timer timer(profile, util::PS_INPUT);
+	/* Separate transforms are used until packing has been validated */
+	auto packed = m_packed && check_stereo_packing();
+	/* Mono only looks at the left channel */
+	pcm_layout layout = packed ? PL_INTERLEAVED : (m_stereo ? PL_PLANAR : PL_MONO);
+	convert_pcm(in_left, in_right, m_sample_size, layout, m_input_left, m_input_right, &m_spectrum.stats_left,
+				&m_spectrum.stats_right);
+	timer.lap(util::PS_FFT);
+
+	auto plan = wisdom::plan_cache()->get(packed ? m_packed_plan_key : m_plan_key);
+	if (!plan)
+		return false;
+
+	if (packed) {
+		fft::execute_c2c(plan.get(), reinterpret_cast<fft_complex *>(m_input), m_packed_output);
+		unpack_stereo_fft(m_packed_output, m_sample_size, m_output_left, m_output_right);
+	} else {
+		/* Does both channels in stereo mode */
+		fft::execute(plan.get(), m_input, m_output);
+	}
+
+	compute_spectrum(m_output_left, m_results, SS_MAGNITUDE, m_spectrum.left.data());
+	if (m_stereo)
+		compute_spectrum(m_output_right, m_results, SS_MAGNITUDE, m_spectrum.right.data());
+	return true;
+}
+
+void fft_stage::unpack_stereo_fft(const fft_complex *packed, size_t sample_size, fft_complex *left,
+								  fft_complex *right) const
+{
+	/* packed is Z = L + iR, both L and R are real so their spectra are
+	 * conjugate symmetric, which gives:
+	 * L[k] = (Z[k] + conj(Z[n - k])) / 2
+	 * R[k] = (Z[k] - conj(Z[n - k])) / 2i */
+	for (size_t k = 0; k <= sample_size / 2; ++k) {
+		const auto &z = packed[k];
+		const auto &z_mirror = packed[(sample_size - k) % sample_size];
+
+		left[k][0] = (z[0] + z_mirror[0]) / 2;
+		left[k][1] = (z[1] - z_mirror[1]) / 2;
+		right[k][0] = (z[1] + z_mirror[1]) / 2;
+		right[k][1] = (z_mirror[0] - z[0]) / 2;
+	}
+}
+
+bool fft_stage::check_stereo_packing()
+{
+	if (!m_packing_checked) {
+		auto *cache = wisdom::plan_cache();
+		auto plan = cache->get(m_plan_key);
+		auto packed_plan = cache->get(m_packed_plan_key);
+		if (!plan || !packed_plan)
+			return false;
+
+		/* Fall back to separate transforms if the packed result is off */
+		m_packing_checked = true;
+		m_packed = validate_stereo_packing(plan.get(), packed_plan.get());
+	}
+	return m_packed;
+}
+
+bool fft_stage::validate_stereo_packing(fft_plan plan, fft_plan packed_plan)
+{
+	/* Run a test signal through both paths, the buffers are overwritten
+	 * on the next tick anyways */
+	const auto n = m_sample_size;
+	for (auto i = 0u; i < n; ++i) {
+		auto phase = 2 * UTIL_PI * i / n;
+		m_input_left[i] = static_cast<fft_real>(8000 * std::sin(phase * 5) + 3000 * std::sin(phase * 40));
+		m_input_right[i] = static_cast<fft_real>(6000 * std::cos(phase * 12) + (i % 7) * 100);
+	}
+	/* The scratch buffer is sized in configure(), this runs on a tick */
+	auto *expected = m_packing_scratch.data();
+	auto *left = expected + m_results * 4;
+	auto *right = left + n;
+	std::copy(m_input_left, m_input_left + n, left);
+	std::copy(m_input_right, m_input_right + n, right);
+
+	fft::execute(plan, m_input, m_output);
+	std::copy(reinterpret_cast<fft_real *>(m_output), reinterpret_cast<fft_real *>(m_output + m_results * 2),
+			  expected);
+	for (auto i = 0u; i < n; ++i) {
+		m_input[i * 2] = left[i];
+		m_input[i * 2 + 1] = right[i];
+	}
+	fft::execute_c2c(packed_plan, reinterpret_cast<fft_complex *>(m_input), m_packed_output);
+	unpack_stereo_fft(m_packed_output, n, m_output_left, m_output_right);
+
+	double max_value = 1, max_error = 0;
+	auto *result = reinterpret_cast<fft_real *>(m_output);
+	for (size_t i = 0; i < m_results * 4; ++i) {
+		max_value = std::max<double>(max_value, std::abs(expected[i]));
+		max_error = std::max<double>(max_error, std::abs(expected[i] - result[i]));
+	}
+
+	auto error = max_error / max_value;
+	if (error > constants::stereo_packing_tolerance) {
+		warn("Packed stereo fft is off by %g, using separate transforms", error);
+		return false;
+	}
+	debug("Packed stereo fft matches separate transforms (error %g)", error);
+	return true;
+}
+
+}
@@ -0,0 +1,91 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "../profiler.hpp"
+#include "fft_plan_cache.hpp"
+#include "pcm_convert.hpp"
+
+namespace audio {
+
+/* Magnitude spectrum of one analyzed buffer */
+struct spectrum {
+	uint64_t sequence = 0;
+	realv left, right; /* sample_size / 2 + 1 magnitudes each, right is empty in mono */
+	pcm_stats stats_left, stats_right;
+};
+
+/* Turns planar float audio into magnitude spectra, used by each visualizer
+ * for its own audio and by the capture hub for audio that's shared */
+class fft_stage {
+	uint32_t m_sample_size = 0;
+	size_t m_results = 0;
+	bool m_stereo = false;
+
+	/* Both channels live in one buffer, so that stereo
+	 * only needs a single plan. Left/right point into them */
+	fft_real *m_input = nullptr;
+	fft_real *m_input_left = nullptr;
+	fft_real *m_input_right = nullptr;
+
+	fft_complex *m_output = nullptr;
+	fft_complex *m_output_left = nullptr;
+	fft_complex *m_output_right = nullptr;
+
+	/* In packed stereo mode the input buffer holds left and right interleaved
+	 * as real and imaginary parts of one complex signal, which is transformed
+	 * into this buffer and then split into the left and right output */
+	bool m_packed = false;
+	bool m_packed_requested = false; /* m_packed turns off if validation fails */
+	bool m_packing_checked = false; /* Checked on the first tick both plans are there */
+	fft_complex *m_packed_output = nullptr;
+	realv m_packing_scratch;
+
+	/* Plans come from the module wide cache in wisdom:: */
+	fft_plan_key m_plan_key, m_packed_plan_key;
+	fft_rigor m_rigor = FR_ESTIMATE;
+
+	spectrum m_spectrum;
+
+	void unpack_stereo_fft(const fft_complex *packed, size_t sample_size, fft_complex *left, fft_complex *right) const;
+	bool check_stereo_packing();
+	bool validate_stereo_packing(fft_plan plan, fft_plan packed_plan);
+
+public:
+	fft_stage() = default;
+	~fft_stage();
+	fft_stage(const fft_stage &) = delete;
+	fft_stage &operator=(const fft_stage &) = delete;
+
+	/* (Re)allocates buffers and prepares plans, so process() never has to.
+	 * Does nothing if none of the arguments changed */
+	void configure(uint32_t sample_size, bool stereo, bool packed, fft_rigor rigor);
+
+	/* Transforms sample_size samples of each channel, in_right is only
+	 * read in stereo. False if there's no plan */
+	bool process(const float *in_left, const float *in_right, util::stage_profile *profile = nullptr);
+
+	/* Only valid after process() returned true */
+	const spectrum &result() const { return m_spectrum; }
+
+	uint32_t sample_size() const { return m_sample_size; }
+	bool stereo() const { return m_stereo; }
+	bool packed() const { return m_packed; }
+};
+
+}
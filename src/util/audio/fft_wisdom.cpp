@@ -0,0 +1,69 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "fft_wisdom.hpp"
+#include "fft_plan_cache.hpp"
+
+namespace audio {
+namespace wisdom {
+
+static fft_plan_cache *shared_cache = nullptr;
+static bool warm = false;
+
+void load(const char *path)
+{
+	if (path) {
+		std::lock_guard<std::mutex> lock(planner_mutex());
+		warm = fft::import_wisdom(path) != 0;
+	}
+
+	if (warm)
+		info("Loaded fftw wisdom from '%s'", path);
+	else
+		info("No fftw wisdom found, plans will be measured from scratch");
+
+	shared_cache = new fft_plan_cache();
+}
+
+void unload(const char *path)
+{
+	if (shared_cache) {
+		info("fftw planning took %.2f ms this session (%s start, %llu plans reused)", shared_cache->plan_time_ms(),
+			 warm ? "warm" : "cold", (unsigned long long)shared_cache->hits());
+		delete shared_cache; /* Waits for background planning */
+		shared_cache = nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(planner_mutex());
+	if (path && !fft::export_wisdom(path))
+		warn("Failed to save fftw wisdom to '%s'", path);
+	fft::cleanup();
+}
+
+bool is_warm()
+{
+	return warm;
+}
+
+fft_plan_cache *plan_cache()
+{
+	return shared_cache;
+}
+
+}
+}
@@ -0,0 +1,38 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+namespace audio {
+class fft_plan_cache;
+
+/* Module wide fftw state. Wisdom is persisted in a file (the plugin
+ * config directory in obs), so plans only have to be measured once per
+ * machine, and all visualizer sources share one plan cache */
+namespace wisdom {
+/* Called from obs_module_load/obs_module_unload, path can be null to
+ * neither import nor export wisdom. The directory has to exist on unload */
+void load(const char *path);
+void unload(const char *path);
+
+/* True if wisdom from a previous session was imported */
+bool is_warm();
+
+fft_plan_cache *plan_cache();
+}
+}
@@ -19,6 +19,7 @@
 #ifdef LINUX
 #include "fifo.hpp"
 #include "../../source/visualizer_source.hpp"
+#include "pcm_convert.hpp"
 #include <fcntl.h>
 #include <unistd.h>
 #include <util/platform.h>
@@ -38,6 +39,7 @@ fifo::~fifo()
 	if (m_fifo_fd)
 		close(m_fifo_fd);
 	m_fifo_fd = 0;
+	bfree(m_pcm);
 }
 
 void fifo::update()
@@ -51,16 +53,23 @@ bool fifo::tick(float seconds)
 	if (m_fifo_fd < 0 && !open_fifo())
 		return false;
 
+	if (m_pcm_len != m_cfg->sample_size) {
+		m_pcm_len = m_cfg->sample_size;
+		m_pcm = static_cast<pcm_stereo_sample *>(brealloc(m_pcm, m_pcm_len * sizeof(pcm_stereo_sample)));
+	}
+
 	auto buffer_size_bytes = static_cast<size_t>(sizeof(pcm_stereo_sample) * m_cfg->sample_size);
 	size_t bytes_left = buffer_size_bytes;
 	auto attempts = 0;
-	memset(m_cfg->buffer, 0, buffer_size_bytes);
+	memset(m_pcm, 0, buffer_size_bytes);
 
 	while (bytes_left > 0) {
-		int64_t bytes_read = read(m_fifo_fd, m_cfg->buffer, bytes_left);
+		auto *dest = reinterpret_cast<uint8_t *>(m_pcm) + (buffer_size_bytes - bytes_left);
+		int64_t bytes_read = read(m_fifo_fd, dest, bytes_left);
 
 		if (bytes_read == 0) {
 			debug("Could not read any bytes");
+			clear_buffer();
 			return false;
 		} else if (bytes_read == -1) {
 			if (errno == EAGAIN) {
@@ -68,7 +77,7 @@ bool fifo::tick(float seconds)
 					debug("Couldn't finish reading buffer, bytes read: %d,"
 						  "buffer size: %d",
 						  bytes_read, buffer_size_bytes);
-					memset(m_cfg->buffer, 0, buffer_size_bytes);
+					clear_buffer();
 					close(m_fifo_fd);
 					m_fifo_fd = -1;
 					return false;
@@ -83,19 +92,26 @@ bool fifo::tick(float seconds)
 		}
 	}
 
+	pcm16_to_planar(m_pcm, m_cfg->sample_size, m_cfg->buffer[0], m_cfg->buffer[1]);
 	return true;
 }
 
+void fifo::clear_buffer()
+{
+	for (auto &buf : m_cfg->buffer)
+		memset(buf, 0, m_cfg->sample_size * sizeof(float));
+}
+
 bool fifo::open_fifo()
 {
 	if (m_fifo_fd)
 		close(m_fifo_fd);
 
-	if (m_file_path && strlen(m_file_path) > 0) {
-		m_fifo_fd = open(m_file_path, O_RDONLY);
+	if (!m_file_path.empty()) {
+		m_fifo_fd = open(m_file_path.c_str(), O_RDONLY);
 
 		if (m_fifo_fd < 0) {
-			warn("Failed to open fifo '%s'", m_file_path);
+			warn("Failed to open fifo '%s'", m_file_path.c_str());
 		} else {
 			auto flags = fcntl(m_fifo_fd, F_GETFL, 0);
 			auto ret = fcntl(m_fifo_fd, F_SETFL, flags | O_NONBLOCK);
@@ -17,14 +17,21 @@
  *************************************************************************/
 
 #include "audio_source.hpp"
+#include "../util.hpp"
+#include <string>
 
 namespace audio {
 class fifo : public audio_source {
 #ifdef LINUX
 private:
-	const char *m_file_path = nullptr;
+	std::string m_file_path;
 	int m_fifo_fd = 0;
+	/* Mpd writes interleaved 16 bit pcm, which is converted
+	 * into the planar float buffers after reading */
+	pcm_stereo_sample *m_pcm = nullptr;
+	size_t m_pcm_len = 0;
 	bool open_fifo();
+	void clear_buffer();
 
 public:
 	fifo(source::config *cfg);
@@ -0,0 +1,108 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "geometry.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace audio {
+
+static inline vertex *add_quad(vertex *out, float x0, float y0, float x1, float y1)
+{
+	out[0] = {x0, y0, 0.f, 0.f};
+	out[1] = {x1, y0, 0.f, 0.f};
+	out[2] = {x0, y1, 0.f, 0.f};
+	out[3] = {x1, y0, 0.f, 0.f};
+	out[4] = {x1, y1, 0.f, 0.f};
+	out[5] = {x0, y1, 0.f, 0.f};
+	return out + BAR_VERTICES;
+}
+
+size_t build_bar_vertices(const fft_real *bars, size_t count, const bar_layout &layout, channel_mode channel,
+						  vertex *out)
+{
+	const auto width = static_cast<float>(layout.bar_width);
+	const auto step = static_cast<float>(layout.bar_width + layout.bar_space);
+	const auto offset = static_cast<float>(layout.stereo_space / 2);
+	const auto center = static_cast<float>(layout.bar_height / 2) + offset;
+	const auto bottom = static_cast<float>(layout.bar_height);
+	auto *v = out;
+
+	for (size_t i = 0; i + DEAD_BAR_OFFSET < count; i++) {
+		/* Every bar is at least one pixel high */
+		auto height = static_cast<float>(std::max<fft_real>(std::round(bars[i]), 1));
+		auto x = i * step;
+
+		switch (channel) {
+		case CM_LEFT:
+			v = add_quad(v, x, center - offset - height, x + width, center - offset);
+			break;
+		case CM_RIGHT:
+			v = add_quad(v, x, center + offset, x + width, center + offset + height);
+			break;
+		default:
+			v = add_quad(v, x, bottom - height, x + width, bottom);
+		}
+	}
+	return static_cast<size_t>(v - out);
+}
+
+size_t build_wire_vertices(const fft_real *bars, size_t count, const wire_layout &layout, channel_mode channel,
+						   vertex *out)
+{
+	const auto step = static_cast<float>(layout.bar_width + layout.bar_space);
+	const auto thickness = static_cast<float>(layout.wire_thickness);
+	float offset = 0.f, center = 0.f, base = static_cast<float>(layout.bar_height), direction = -1.f;
+
+	if (channel != CM_BOTH) {
+		offset = static_cast<float>(layout.stereo_space / 2);
+		center = static_cast<float>(layout.bar_height / 2) + offset;
+		/* The left channel grows up from the center, the right one down */
+		base = channel == CM_LEFT ? center - offset : center + offset;
+		direction = channel == CM_LEFT ? -1.f : 1.f;
+	}
+
+	auto *v = out;
+	for (size_t i = 0; i + DEAD_BAR_OFFSET < count; i++) {
+		auto height = static_cast<float>(std::max<fft_real>(std::round(bars[i]), 1));
+		auto x = i * step;
+		auto y = base + direction * height;
+
+		switch (layout.wire_mode) {
+		case WM_THIN:
+			*v++ = {x, y, 0.f, 0.f};
+			break;
+		case WM_THICK:
+			*v++ = {x, y, 0.f, 0.f};
+			*v++ = {x, y - direction * thickness, 0.f, 0.f};
+			break;
+		case WM_FILL:
+			*v++ = {x, y, 0.f, 0.f};
+			*v++ = {x, base, 0.f, 0.f};
+			break;
+		case WM_FILL_INVERTED:
+			/* Always fills up to the top */
+			*v++ = {x, layout.bar_height - height, 0.f, 0.f};
+			*v++ = {x, 0.f, 0.f, 0.f};
+			break;
+		}
+	}
+	return static_cast<size_t>(v - out);
+}
+
+}
@@ -0,0 +1,75 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "spectrum_analyzer.hpp"
+#include <cstdint>
+#include <vector>
+
+#define BAR_VERTICES 6 /* Two triangles per bar */
+
+namespace audio {
+
+/* Same layout as libobs' vec3 (which is padded for sse), so that
+ * vertices can be copied into a vertex buffer as they are */
+struct vertex {
+	float x, y, z, w;
+};
+
+using vertexv = std::vector<vertex>;
+
+/* The part of the settings that decides where bars are drawn,
+ * field names match source::config */
+struct bar_layout {
+	uint16_t bar_width = defaults::bar_width;
+	uint16_t bar_space = defaults::bar_space;
+	uint16_t bar_height = defaults::bar_height;
+	uint16_t stereo_space = 0;
+	bool stereo = defaults::stereo;
+};
+
+/* Wires have a point (or two) where every bar would be */
+struct wire_layout : bar_layout {
+	enum wire_mode wire_mode = defaults::wire_mode;
+	uint16_t wire_thickness = defaults::wire_thickness;
+};
+
+inline size_t bar_vertex_count(size_t bars)
+{
+	return bars > DEAD_BAR_OFFSET ? (bars - DEAD_BAR_OFFSET) * BAR_VERTICES : 0;
+}
+
+/* Writes two triangles (for GS_TRIS) per bar into out, which has to hold
+ * bar_vertex_count(count) vertices, the dead bars at the end are skipped.
+ * CM_BOTH draws mono bars standing on the bottom, in stereo CM_LEFT grows
+ * up from the center and CM_RIGHT down. Returns the number of vertices */
+size_t build_bar_vertices(const fft_real *bars, size_t count, const bar_layout &layout, channel_mode channel,
+						  vertex *out);
+
+/* One point per bar for WM_THIN (a GS_LINESTRIP), two for the others (GS_TRISTRIP) */
+inline size_t wire_vertex_count(wire_mode mode, size_t bars)
+{
+	return bars > DEAD_BAR_OFFSET ? (bars - DEAD_BAR_OFFSET) * (mode == WM_THIN ? 1 : 2) : 0;
+}
+
+/* Same as build_bar_vertices() for wires, out has to
+ * hold wire_vertex_count(layout.wire_mode, count) vertices */
+size_t build_wire_vertices(const fft_real *bars, size_t count, const wire_layout &layout, channel_mode channel,
+						   vertex *out);
+
+}
@@ -0,0 +1,197 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "magnitude.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MAG_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MAG_AVX_TARGET
+#else
+#define MAG_AVX_TARGET __attribute__((target("avx")))
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define MAG_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace audio {
+
+/* Computes the first n bins and returns how many were done, the rest
+ * is left to power_range. Decibels are done from the power afterwards */
+using magnitude_kernel_fn = size_t (*)(const fft_complex *in, size_t n, bool root, fft_real *out);
+
+static void power_range(const fft_complex *in, size_t begin, size_t end, bool root, fft_real *out)
+{
+	for (auto i = begin; i < end; ++i) {
+		const fft_real power = (in[i][0] * in[i][0]) + (in[i][1] * in[i][1]);
+		out[i] = root ? std::sqrt(power) : power;
+	}
+}
+
+static void to_decibel(size_t n, fft_real *out)
+{
+	const auto floor = static_cast<fft_real>(constants::spectrum_db_floor);
+	for (size_t i = 0; i < n; ++i)
+		out[i] = out[i] > 0 ? std::max<fft_real>(10 * std::log10(out[i]), floor) : floor;
+}
+
+#ifdef MAG_X86
+static size_t power_sse(const fft_complex *in, size_t n, bool root, fft_real *out)
+{
+	const auto *src = reinterpret_cast<const fft_real *>(in);
+	size_t i = 0;
+
+#ifdef SPECTRALIZER_FLOAT_FFT
+	for (; i + 4 <= n; i += 4) {
+		const __m128 a = _mm_loadu_ps(src + i * 2), b = _mm_loadu_ps(src + i * 2 + 4);
+		const __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		const __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		const __m128 power = _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im));
+		_mm_storeu_ps(out + i, root ? _mm_sqrt_ps(power) : power);
+	}
+#else
+	for (; i + 2 <= n; i += 2) {
+		const __m128d a = _mm_loadu_pd(src + i * 2), b = _mm_loadu_pd(src + i * 2 + 2);
+		const __m128d re = _mm_unpacklo_pd(a, b), im = _mm_unpackhi_pd(a, b);
+		const __m128d power = _mm_add_pd(_mm_mul_pd(re, re), _mm_mul_pd(im, im));
+		_mm_storeu_pd(out + i, root ? _mm_sqrt_pd(power) : power);
+	}
+#endif
+	return i;
+}
+
+MAG_AVX_TARGET static size_t power_avx(const fft_complex *in, size_t n, bool root, fft_real *out)
+{
+	const auto *src = reinterpret_cast<const fft_real *>(in);
+	size_t i = 0;
+
+	/* Shuffles work per 128 bit lane, so the halves are swapped into
+	 * place first to get re and im in bin order */
+#ifdef SPECTRALIZER_FLOAT_FFT
+	for (; i + 8 <= n; i += 8) {
+		const __m256 a = _mm256_loadu_ps(src + i * 2), b = _mm256_loadu_ps(src + i * 2 + 8);
+		const __m256 lo = _mm256_permute2f128_ps(a, b, 0x20), hi = _mm256_permute2f128_ps(a, b, 0x31);
+		const __m256 re = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+		const __m256 im = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+		const __m256 power = _mm256_add_ps(_mm256_mul_ps(re, re), _mm256_mul_ps(im, im));
+		_mm256_storeu_ps(out + i, root ? _mm256_sqrt_ps(power) : power);
+	}
+#else
+	for (; i + 4 <= n; i += 4) {
+		const __m256d a = _mm256_loadu_pd(src + i * 2), b = _mm256_loadu_pd(src + i * 2 + 4);
+		const __m256d lo = _mm256_permute2f128_pd(a, b, 0x20), hi = _mm256_permute2f128_pd(a, b, 0x31);
+		const __m256d re = _mm256_unpacklo_pd(lo, hi), im = _mm256_unpackhi_pd(lo, hi);
+		const __m256d power = _mm256_add_pd(_mm256_mul_pd(re, re), _mm256_mul_pd(im, im));
+		_mm256_storeu_pd(out + i, root ? _mm256_sqrt_pd(power) : power);
+	}
+#endif
+	return i;
+}
+
+static bool cpu_has_avx()
+{
+#ifdef _MSC_VER
+	int regs[4];
+	__cpuid(regs, 1);
+	return (regs[2] & (1 << 27)) && (regs[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+#else
+	return __builtin_cpu_supports("avx");
+#endif
+}
+#endif /* MAG_X86 */
+
+#ifdef MAG_NEON
+static size_t power_neon(const fft_complex *in, size_t n, bool root, fft_real *out)
+{
+	const auto *src = reinterpret_cast<const fft_real *>(in);
+	size_t i = 0;
+
+	/* vld2 splits re and im while loading */
+#ifdef SPECTRALIZER_FLOAT_FFT
+	for (; i + 4 <= n; i += 4) {
+		const float32x4x2_t bins = vld2q_f32(src + i * 2);
+		const float32x4_t power = vaddq_f32(vmulq_f32(bins.val[0], bins.val[0]), vmulq_f32(bins.val[1], bins.val[1]));
+		vst1q_f32(out + i, root ? vsqrtq_f32(power) : power);
+	}
+#else
+	for (; i + 2 <= n; i += 2) {
+		const float64x2x2_t bins = vld2q_f64(src + i * 2);
+		const float64x2_t power = vaddq_f64(vmulq_f64(bins.val[0], bins.val[0]), vmulq_f64(bins.val[1], bins.val[1]));
+		vst1q_f64(out + i, root ? vsqrtq_f64(power) : power);
+	}
+#endif
+	return i;
+}
+#endif /* MAG_NEON */
+
+struct magnitude_kernel {
+	magnitude_kernel_fn power;
+	const char *name;
+};
+
+static magnitude_kernel select_kernel()
+{
+#ifdef MAG_X86
+	if (cpu_has_avx())
+		return {power_avx, "AVX"};
+	return {power_sse, "SSE"};
+#elif defined(MAG_NEON)
+	return {power_neon, "NEON"};
+#else
+	return {nullptr, "scalar"};
+#endif
+}
+
+static const magnitude_kernel &active_kernel()
+{
+	static const magnitude_kernel kernel = select_kernel();
+	return kernel;
+}
+
+void compute_spectrum_scalar(const fft_complex *in, size_t n, spectrum_scale scale, fft_real *out)
+{
+	power_range(in, 0, n, scale == SS_MAGNITUDE, out);
+	if (scale == SS_DECIBEL)
+		to_decibel(n, out);
+}
+
+void compute_spectrum(const fft_complex *in, size_t n, spectrum_scale scale, fft_real *out)
+{
+	const auto &kernel = active_kernel();
+	const bool root = scale == SS_MAGNITUDE;
+	size_t done = 0;
+
+	if (kernel.power)
+		done = kernel.power(in, n, root, out);
+	power_range(in, done, n, root, out);
+
+	if (scale == SS_DECIBEL)
+		to_decibel(n, out);
+}
+
+const char *spectrum_kernel_name()
+{
+	return active_kernel().name;
+}
+
+}
@@ -0,0 +1,44 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "../core.hpp"
+#include "fft.hpp"
+
+namespace audio {
+
+/* What compute_spectrum turns each complex bin into */
+enum spectrum_scale {
+	SS_MAGNITUDE, /* sqrt(re^2 + im^2) */
+	SS_POWER,     /* re^2 + im^2 */
+	SS_DECIBEL    /* 10 * log10(re^2 + im^2), floored at constants::spectrum_db_floor */
+};
+
+/* Computes the whole spectrum of n bins in one pass, so that bars
+ * sharing bins don't recompute them. Picks the widest SIMD path the cpu
+ * supports, results are identical to compute_spectrum_scalar as long as
+ * the file is built without fused multiply-add (-ffp-contract=off) */
+void compute_spectrum(const fft_complex *in, size_t n, spectrum_scale scale, fft_real *out);
+
+/* Plain C++ reference implementation, also used for the tail of each buffer */
+void compute_spectrum_scalar(const fft_complex *in, size_t n, spectrum_scale scale, fft_real *out);
+
+/* Name of the path compute_spectrum uses on this cpu */
+const char *spectrum_kernel_name();
+
+}
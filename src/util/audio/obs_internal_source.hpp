@@ -18,30 +18,20 @@
 
 #pragma once
 #include "audio_source.hpp"
-#include <media-io/audio-io.h>
-#include <mutex>
-#include <obs-module.h>
-#include <util/circlebuf.h>
+#include "capture_hub.hpp"
+#include <string>
 
 namespace audio {
 
+/* Reads spectra from the capture hub of the selected obs source,
+ * which is shared with every other visualizer using the same source */
 class obs_internal_source : public audio_source {
 	std::string m_capture_name = "";
-	obs_weak_source_t *m_capture_source = nullptr;
-	size_t m_max_capture_frames = 0;
-	uint8_t m_num_channels = 0;
-	uint64_t m_capture_check_time = 0;
-	circlebuf m_audio_data[2]; /* Left & Right data from capture callback */
-	float *m_audio_buf[2]{};   /* Copy of captured audio */
-	size_t m_audio_buf_len = 0;
-#ifdef LINUX
-	/* Used to keep track of last audio capture callback to decide
-	 * whether audio playback has stopped to clear the buffer.
-	 * This usually is needed when JACK is used
-	 */
-	uint64_t m_last_capture = 0;
-#endif
-	void resize_audio_buf(size_t new_len);
+	capture_hub *m_hub = nullptr;
+	size_t m_subscription = 0;
+	spectrum m_spectrum;
+
+	capture_hub::subscriber make_subscriber() const;
 
 public:
 	obs_internal_source(source::config *cfg);
@@ -49,8 +39,10 @@ public:
 
 	bool tick(float seconds) override;
 	void update() override;
-
-	void capture(obs_source_t *src, const struct audio_data *data, bool muted);
+	bool event_driven() const override { return true; }
+	bool audio_ready() const override;
+	const spectrum *shared_spectrum() const override { return &m_spectrum; }
+	uint64_t revision() const override;
 };
 
 }
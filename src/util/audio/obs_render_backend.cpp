@@ -0,0 +1,111 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "obs_render_backend.hpp"
+#include "../util.hpp"
+#include <cstring>
+
+namespace audio {
+
+static_assert(sizeof(vertex) == sizeof(vec3), "Vertices are copied into vertex buffers as they are");
+
+obs_render_backend::~obs_render_backend()
+{
+	obs_enter_graphics();
+	for (auto *vb : m_buffers)
+		gs_vertexbuffer_destroy(vb);
+	obs_leave_graphics();
+}
+
+gs_vertbuffer_t *obs_render_backend::get(vertex_buffer buffer) const
+{
+	return buffer && buffer <= m_buffers.size() ? m_buffers[buffer - 1] : nullptr;
+}
+
+vertex_buffer obs_render_backend::create_vertex_buffer(size_t vertices)
+{
+	auto *data = gs_vbdata_create();
+	data->num = vertices;
+	data->points = static_cast<vec3 *>(bzalloc(sizeof(vec3) * vertices));
+	auto *vb = gs_vertexbuffer_create(data, GS_DYNAMIC);
+	if (!vb)
+		return 0;
+
+	/* Reuse the slot of a destroyed buffer */
+	for (size_t i = 0; i < m_buffers.size(); i++) {
+		if (!m_buffers[i]) {
+			m_buffers[i] = vb;
+			return static_cast<vertex_buffer>(i + 1);
+		}
+	}
+	m_buffers.push_back(vb);
+	return static_cast<vertex_buffer>(m_buffers.size());
+}
+
+void obs_render_backend::destroy_vertex_buffer(vertex_buffer buffer)
+{
+	auto *vb = get(buffer);
+	if (!vb)
+		return;
+	gs_vertexbuffer_destroy(vb);
+	m_buffers[buffer - 1] = nullptr;
+}
+
+void obs_render_backend::upload(vertex_buffer buffer, const vertex *vertices, size_t count)
+{
+	auto *vb = get(buffer);
+	if (!vb)
+		return;
+	auto *data = gs_vertexbuffer_get_data(vb);
+	memcpy(data->points, vertices, UTIL_MIN(count, data->num) * sizeof(vertex));
+	gs_vertexbuffer_flush(vb);
+}
+
+void obs_render_backend::draw(vertex_buffer buffer, draw_mode mode, size_t first, size_t count)
+{
+	auto *vb = get(buffer);
+	if (!vb)
+		return;
+
+	gs_draw_mode gs_mode = GS_TRIS;
+	if (mode == DM_TRISTRIP)
+		gs_mode = GS_TRISTRIP;
+	else if (mode == DM_LINESTRIP)
+		gs_mode = GS_LINESTRIP;
+
+	gs_load_vertexbuffer(vb);
+	gs_load_indexbuffer(nullptr);
+	gs_draw(gs_mode, static_cast<uint32_t>(first), static_cast<uint32_t>(count));
+}
+
+void obs_render_backend::push_matrix()
+{
+	gs_matrix_push();
+}
+
+void obs_render_backend::translate(float x, float y)
+{
+	gs_matrix_translate3f(x, y, 0.f);
+}
+
+void obs_render_backend::pop_matrix()
+{
+	gs_matrix_pop();
+}
+
+}
@@ -0,0 +1,48 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "render_backend.hpp"
+#include <graphics/graphics.h>
+#include <vector>
+
+namespace audio {
+
+/* Draws through libobs, has to be used inside the graphics context */
+class obs_render_backend : public render_backend {
+	std::vector<gs_vertbuffer_t *> m_buffers; /* By id - 1 */
+
+	gs_vertbuffer_t *get(vertex_buffer buffer) const;
+
+public:
+	obs_render_backend() = default;
+	~obs_render_backend() override; /* Enters the graphics context itself */
+	obs_render_backend(const obs_render_backend &) = delete;
+	obs_render_backend &operator=(const obs_render_backend &) = delete;
+
+	vertex_buffer create_vertex_buffer(size_t vertices) override;
+	void destroy_vertex_buffer(vertex_buffer buffer) override;
+	void upload(vertex_buffer buffer, const vertex *vertices, size_t count) override;
+	void draw(vertex_buffer buffer, draw_mode mode, size_t first, size_t count) override;
+
+	void push_matrix() override;
+	void translate(float x, float y) override;
+	void pop_matrix() override;
+};
+
+}
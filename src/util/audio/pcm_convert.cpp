@@ -0,0 +1,366 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "pcm_convert.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PCM_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PCM_AVX_TARGET
+#else
+#define PCM_AVX_TARGET __attribute__((target("avx")))
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define PCM_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace audio {
+
+/* Running per channel values, turned into pcm_stats at the end */
+struct pcm_accum {
+	float max = 0.f, min = 0.f;
+	double sum_squares = 0.0;
+};
+
+/* Converts the first n frames and returns how many were done,
+ * the rest is left to convert_range */
+using pcm_kernel_fn = size_t (*)(const float *in_left, const float *in_right, size_t n, pcm_layout layout,
+								 fft_real *left, fft_real *right, pcm_accum *acc_left, pcm_accum *acc_right);
+
+static inline void accumulate(pcm_accum *acc, float sample)
+{
+	acc->max = std::max(acc->max, sample);
+	acc->min = std::min(acc->min, sample);
+	acc->sum_squares += static_cast<double>(sample) * sample;
+}
+
+static void convert_range(const float *in_left, const float *in_right, size_t begin, size_t end, pcm_layout layout,
+						  fft_real *left, fft_real *right, pcm_accum *acc_left, pcm_accum *acc_right)
+{
+	const auto scale = static_cast<float>(constants::pcm_scale);
+
+	for (auto i = begin; i < end; ++i) {
+		const float l = in_left[i];
+		accumulate(acc_left, l);
+
+		if (layout == PL_MONO) {
+			left[i] = l * scale;
+			continue;
+		}
+
+		const float r = in_right[i];
+		accumulate(acc_right, r);
+
+		if (layout == PL_PLANAR) {
+			left[i] = l * scale;
+			right[i] = r * scale;
+		} else {
+			left[i * 2] = l * scale;
+			left[i * 2 + 1] = r * scale;
+		}
+	}
+}
+
+static void finish(const pcm_accum &acc, size_t n, pcm_stats *stats)
+{
+	if (!stats)
+		return;
+	/* Negative samples count too, silence means every sample is zero */
+	stats->silent = acc.max == 0.f && acc.min == 0.f;
+	stats->peak = std::max(acc.max, -acc.min);
+	stats->rms = n ? std::sqrt(acc.sum_squares / n) : 0.0;
+}
+
+#ifdef PCM_X86
+static inline void store_sse(fft_real *dst, __m128 v)
+{
+#ifdef SPECTRALIZER_FLOAT_FFT
+	_mm_storeu_ps(dst, v);
+#else
+	_mm_storeu_pd(dst, _mm_cvtps_pd(v));
+	_mm_storeu_pd(dst + 2, _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+#endif
+}
+
+static inline __m128d add_squares_sse(__m128d acc, __m128 v)
+{
+	const __m128d lo = _mm_cvtps_pd(v), hi = _mm_cvtps_pd(_mm_movehl_ps(v, v));
+	return _mm_add_pd(_mm_add_pd(acc, _mm_mul_pd(lo, lo)), _mm_mul_pd(hi, hi));
+}
+
+static inline void reduce_sse(__m128 max, __m128 min, __m128d squares, pcm_accum *acc)
+{
+	alignas(16) float max_lanes[4], min_lanes[4];
+	alignas(16) double sums[2];
+	_mm_store_ps(max_lanes, max);
+	_mm_store_ps(min_lanes, min);
+	_mm_store_pd(sums, squares);
+
+	acc->max = std::max({acc->max, max_lanes[0], max_lanes[1], max_lanes[2], max_lanes[3]});
+	acc->min = std::min({acc->min, min_lanes[0], min_lanes[1], min_lanes[2], min_lanes[3]});
+	acc->sum_squares += sums[0] + sums[1];
+}
+
+static size_t convert_sse(const float *in_left, const float *in_right, size_t n, pcm_layout layout, fft_real *left,
+						  fft_real *right, pcm_accum *acc_left, pcm_accum *acc_right)
+{
+	const __m128 scale = _mm_set1_ps(static_cast<float>(constants::pcm_scale));
+	__m128 max_left = _mm_setzero_ps(), min_left = max_left, max_right = max_left, min_right = max_left;
+	__m128d squares_left = _mm_setzero_pd(), squares_right = squares_left;
+	size_t i = 0;
+
+	/* max/min return their second operand when either is NaN, with the running
+	 * value there a NaN sample is skipped like std::max/min in convert_range do */
+	for (; i + 4 <= n; i += 4) {
+		const __m128 l = _mm_loadu_ps(in_left + i);
+		max_left = _mm_max_ps(l, max_left);
+		min_left = _mm_min_ps(l, min_left);
+		squares_left = add_squares_sse(squares_left, l);
+
+		if (layout == PL_MONO) {
+			store_sse(left + i, _mm_mul_ps(l, scale));
+			continue;
+		}
+
+		const __m128 r = _mm_loadu_ps(in_right + i);
+		max_right = _mm_max_ps(r, max_right);
+		min_right = _mm_min_ps(r, min_right);
+		squares_right = add_squares_sse(squares_right, r);
+
+		const __m128 scaled_l = _mm_mul_ps(l, scale), scaled_r = _mm_mul_ps(r, scale);
+		if (layout == PL_PLANAR) {
+			store_sse(left + i, scaled_l);
+			store_sse(right + i, scaled_r);
+		} else {
+			store_sse(left + i * 2, _mm_unpacklo_ps(scaled_l, scaled_r));
+			store_sse(left + i * 2 + 4, _mm_unpackhi_ps(scaled_l, scaled_r));
+		}
+	}
+
+	reduce_sse(max_left, min_left, squares_left, acc_left);
+	reduce_sse(max_right, min_right, squares_right, acc_right);
+	return i;
+}
+
+PCM_AVX_TARGET static inline void store_avx(fft_real *dst, __m256 v)
+{
+#ifdef SPECTRALIZER_FLOAT_FFT
+	_mm256_storeu_ps(dst, v);
+#else
+	_mm256_storeu_pd(dst, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+	_mm256_storeu_pd(dst + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+#endif
+}
+
+PCM_AVX_TARGET static inline __m256d add_squares_avx(__m256d acc, __m256 v)
+{
+	const __m256d lo = _mm256_cvtps_pd(_mm256_castps256_ps128(v)), hi = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+	return _mm256_add_pd(_mm256_add_pd(acc, _mm256_mul_pd(lo, lo)), _mm256_mul_pd(hi, hi));
+}
+
+PCM_AVX_TARGET static inline void reduce_avx(__m256 max, __m256 min, __m256d squares, pcm_accum *acc)
+{
+	reduce_sse(_mm_max_ps(_mm256_castps256_ps128(max), _mm256_extractf128_ps(max, 1)),
+			   _mm_min_ps(_mm256_castps256_ps128(min), _mm256_extractf128_ps(min, 1)),
+			   _mm_add_pd(_mm256_castpd256_pd128(squares), _mm256_extractf128_pd(squares, 1)), acc);
+}
+
+PCM_AVX_TARGET static size_t convert_avx(const float *in_left, const float *in_right, size_t n, pcm_layout layout,
+										 fft_real *left, fft_real *right, pcm_accum *acc_left, pcm_accum *acc_right)
+{
+	const __m256 scale = _mm256_set1_ps(static_cast<float>(constants::pcm_scale));
+	__m256 max_left = _mm256_setzero_ps(), min_left = max_left, max_right = max_left, min_right = max_left;
+	__m256d squares_left = _mm256_setzero_pd(), squares_right = squares_left;
+	size_t i = 0;
+
+	for (; i + 8 <= n; i += 8) {
+		const __m256 l = _mm256_loadu_ps(in_left + i);
+		max_left = _mm256_max_ps(l, max_left);
+		min_left = _mm256_min_ps(l, min_left);
+		squares_left = add_squares_avx(squares_left, l);
+
+		if (layout == PL_MONO) {
+			store_avx(left + i, _mm256_mul_ps(l, scale));
+			continue;
+		}
+
+		const __m256 r = _mm256_loadu_ps(in_right + i);
+		max_right = _mm256_max_ps(r, max_right);
+		min_right = _mm256_min_ps(r, min_right);
+		squares_right = add_squares_avx(squares_right, r);
+
+		const __m256 scaled_l = _mm256_mul_ps(l, scale), scaled_r = _mm256_mul_ps(r, scale);
+		if (layout == PL_PLANAR) {
+			store_avx(left + i, scaled_l);
+			store_avx(right + i, scaled_r);
+		} else {
+			/* unpack works per 128 bit lane, so the halves have to be put back in order */
+			const __m256 lo = _mm256_unpacklo_ps(scaled_l, scaled_r), hi = _mm256_unpackhi_ps(scaled_l, scaled_r);
+			store_avx(left + i * 2, _mm256_permute2f128_ps(lo, hi, 0x20));
+			store_avx(left + i * 2 + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+		}
+	}
+
+	reduce_avx(max_left, min_left, squares_left, acc_left);
+	reduce_avx(max_right, min_right, squares_right, acc_right);
+	return i;
+}
+
+static bool cpu_has_avx()
+{
+#ifdef _MSC_VER
+	int regs[4];
+	__cpuid(regs, 1);
+	return (regs[2] & (1 << 27)) && (regs[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+#else
+	return __builtin_cpu_supports("avx");
+#endif
+}
+#endif /* PCM_X86 */
+
+#ifdef PCM_NEON
+static inline void store_neon(fft_real *dst, float32x4_t v)
+{
+#ifdef SPECTRALIZER_FLOAT_FFT
+	vst1q_f32(dst, v);
+#else
+	vst1q_f64(dst, vcvt_f64_f32(vget_low_f32(v)));
+	vst1q_f64(dst + 2, vcvt_high_f64_f32(v));
+#endif
+}
+
+static inline float64x2_t add_squares_neon(float64x2_t acc, float32x4_t v)
+{
+	const float64x2_t lo = vcvt_f64_f32(vget_low_f32(v)), hi = vcvt_high_f64_f32(v);
+	return vfmaq_f64(vfmaq_f64(acc, lo, lo), hi, hi);
+}
+
+static size_t convert_neon(const float *in_left, const float *in_right, size_t n, pcm_layout layout, fft_real *left,
+						   fft_real *right, pcm_accum *acc_left, pcm_accum *acc_right)
+{
+	const float scale = static_cast<float>(constants::pcm_scale);
+	float32x4_t max_left = vdupq_n_f32(0.f), min_left = max_left, max_right = max_left, min_right = max_left;
+	float64x2_t squares_left = vdupq_n_f64(0.0), squares_right = squares_left;
+	size_t i = 0;
+
+	/* maxnm/minnm skip a quiet NaN sample like std::max/min in convert_range do */
+	for (; i + 4 <= n; i += 4) {
+		const float32x4_t l = vld1q_f32(in_left + i);
+		max_left = vmaxnmq_f32(max_left, l);
+		min_left = vminnmq_f32(min_left, l);
+		squares_left = add_squares_neon(squares_left, l);
+
+		if (layout == PL_MONO) {
+			store_neon(left + i, vmulq_n_f32(l, scale));
+			continue;
+		}
+
+		const float32x4_t r = vld1q_f32(in_right + i);
+		max_right = vmaxnmq_f32(max_right, r);
+		min_right = vminnmq_f32(min_right, r);
+		squares_right = add_squares_neon(squares_right, r);
+
+		const float32x4_t scaled_l = vmulq_n_f32(l, scale), scaled_r = vmulq_n_f32(r, scale);
+		if (layout == PL_PLANAR) {
+			store_neon(left + i, scaled_l);
+			store_neon(right + i, scaled_r);
+		} else {
+			const float32x4x2_t zipped = vzipq_f32(scaled_l, scaled_r);
+			store_neon(left + i * 2, zipped.val[0]);
+			store_neon(left + i * 2 + 4, zipped.val[1]);
+		}
+	}
+
+	acc_left->max = std::max(acc_left->max, vmaxvq_f32(max_left));
+	acc_left->min = std::min(acc_left->min, vminvq_f32(min_left));
+	acc_left->sum_squares += vaddvq_f64(squares_left);
+	acc_right->max = std::max(acc_right->max, vmaxvq_f32(max_right));
+	acc_right->min = std::min(acc_right->min, vminvq_f32(min_right));
+	acc_right->sum_squares += vaddvq_f64(squares_right);
+	return i;
+}
+#endif /* PCM_NEON */
+
+struct pcm_kernel {
+	pcm_kernel_fn convert;
+	const char *name;
+};
+
+static pcm_kernel select_kernel()
+{
+#ifdef PCM_X86
+	if (cpu_has_avx())
+		return {convert_avx, "AVX"};
+	return {convert_sse, "SSE"};
+#elif defined(PCM_NEON)
+	return {convert_neon, "NEON"};
+#else
+	return {nullptr, "scalar"};
+#endif
+}
+
+static const pcm_kernel &active_kernel()
+{
+	static const pcm_kernel kernel = select_kernel();
+	return kernel;
+}
+
+void convert_pcm_scalar(const float *in_left, const float *in_right, size_t sample_size, pcm_layout layout,
+						fft_real *left, fft_real *right, pcm_stats *stats_left, pcm_stats *stats_right)
+{
+	pcm_accum acc_left, acc_right;
+	convert_range(in_left, in_right, 0, sample_size, layout, left, right, &acc_left, &acc_right);
+	finish(acc_left, sample_size, stats_left);
+	finish(acc_right, sample_size, stats_right);
+}
+
+void convert_pcm(const float *in_left, const float *in_right, size_t sample_size, pcm_layout layout, fft_real *left,
+				 fft_real *right, pcm_stats *stats_left, pcm_stats *stats_right)
+{
+	const auto &kernel = active_kernel();
+	pcm_accum acc_left, acc_right;
+	size_t done = 0;
+
+	if (kernel.convert)
+		done = kernel.convert(in_left, in_right, sample_size, layout, left, right, &acc_left, &acc_right);
+	convert_range(in_left, in_right, done, sample_size, layout, left, right, &acc_left, &acc_right);
+
+	finish(acc_left, sample_size, stats_left);
+	finish(acc_right, sample_size, stats_right);
+}
+
+const char *pcm_kernel_name()
+{
+	return active_kernel().name;
+}
+
+void pcm16_to_planar(const pcm_stereo_sample *in, size_t sample_size, float *left, float *right)
+{
+	const auto scale = static_cast<float>(1.0 / constants::pcm_scale);
+	for (size_t i = 0; i < sample_size; ++i) {
+		left[i] = in[i].l * scale;
+		right[i] = in[i].r * scale;
+	}
+}
+
+}
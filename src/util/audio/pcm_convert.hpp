@@ -0,0 +1,56 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "../core.hpp"
+#include "fft.hpp"
+
+namespace audio {
+
+/* Where convert_pcm writes its samples to */
+enum pcm_layout {
+	PL_MONO,       /* Left channel into left */
+	PL_PLANAR,     /* Left channel into left, right channel into right */
+	PL_INTERLEAVED /* Both channels alternating into left (2 * sample_size values) */
+};
+
+/* Relative to full scale */
+struct pcm_stats {
+	bool silent = true;
+	float peak = 0.f;
+	double rms = 0.0;
+};
+
+/* Converts planar float audio, as obs delivers it, into fft input and gathers
+ * per channel stats in the same pass. Samples are scaled by constants::pcm_scale
+ * to keep the 16 bit range the bar scaling was tuned for. in_right is only read
+ * for stereo layouts. Picks the widest SIMD path the cpu supports */
+void convert_pcm(const float *in_left, const float *in_right, size_t sample_size, pcm_layout layout, fft_real *left,
+				 fft_real *right, pcm_stats *stats_left, pcm_stats *stats_right);
+
+/* Plain C++ reference implementation, also used for the tail of each buffer */
+void convert_pcm_scalar(const float *in_left, const float *in_right, size_t sample_size, pcm_layout layout,
+						fft_real *left, fft_real *right, pcm_stats *stats_left, pcm_stats *stats_right);
+
+/* Name of the path convert_pcm uses on this cpu */
+const char *pcm_kernel_name();
+
+/* Edge adapter for sources that deliver interleaved 16 bit pcm */
+void pcm16_to_planar(const pcm_stereo_sample *in, size_t sample_size, float *left, float *right);
+
+}
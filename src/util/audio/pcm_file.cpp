@@ -0,0 +1,180 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "pcm_file.hpp"
+#include <cstring>
+
+#define WAV_FORMAT_PCM 1
+#define WAV_FORMAT_FLOAT 3
+#define WAV_FORMAT_EXTENSIBLE 0xfffe
+
+namespace audio {
+
+static uint16_t read_u16(const uint8_t *p)
+{
+	return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+	return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16 |
+		   static_cast<uint32_t>(p[3]) << 24;
+}
+
+pcm_file::~pcm_file()
+{
+	close();
+}
+
+bool pcm_file::open(const char *path, bool raw, uint32_t raw_sample_rate)
+{
+	close();
+	m_file = std::fopen(path, "rb");
+	if (!m_file) {
+		warn("Failed to open '%s'", path);
+		return false;
+	}
+
+	if (raw) {
+		m_format = SF_S16;
+		m_sample_rate = raw_sample_rate;
+		m_channels = 2;
+		m_block_align = sizeof(pcm_stereo_sample);
+		m_data_start = 0;
+		std::fseek(m_file, 0, SEEK_END);
+		m_frames = static_cast<uint64_t>(std::ftell(m_file)) / m_block_align;
+		std::fseek(m_file, 0, SEEK_SET);
+	} else if (!read_wav_header()) {
+		warn("'%s' isn't a 16 bit or float wav file", path);
+		close();
+		return false;
+	}
+
+	if (!m_frames) {
+		warn("'%s' doesn't contain any audio", path);
+		close();
+		return false;
+	}
+
+	m_position = 0;
+	debug("Opened '%s': %u Hz, %u channel(s), %llu frames", path, m_sample_rate, m_channels,
+		  (unsigned long long)m_frames);
+	return true;
+}
+
+bool pcm_file::read_wav_header()
+{
+	uint8_t header[12];
+	if (std::fread(header, 1, sizeof(header), m_file) != sizeof(header) || std::memcmp(header, "RIFF", 4) ||
+		std::memcmp(header + 8, "WAVE", 4))
+		return false;
+
+	bool have_format = false;
+	uint16_t bits = 0, format = 0;
+
+	for (;;) {
+		uint8_t chunk[8];
+		if (std::fread(chunk, 1, sizeof(chunk), m_file) != sizeof(chunk))
+			return false;
+		uint32_t size = read_u32(chunk + 4);
+
+		if (!std::memcmp(chunk, "fmt ", 4)) {
+			uint8_t fmt[40] = {};
+			const auto length = UTIL_MIN(size, static_cast<uint32_t>(sizeof(fmt)));
+			if (size < 16 || std::fread(fmt, 1, length, m_file) != length)
+				return false;
+			format = read_u16(fmt);
+			m_channels = read_u16(fmt + 2);
+			m_sample_rate = read_u32(fmt + 4);
+			m_block_align = read_u16(fmt + 12);
+			bits = read_u16(fmt + 14);
+			/* The actual format is the start of the sub format guid */
+			if (format == WAV_FORMAT_EXTENSIBLE && size >= 26)
+				format = read_u16(fmt + 24);
+			std::fseek(m_file, size - length + (size & 1), SEEK_CUR);
+			have_format = true;
+		} else if (!std::memcmp(chunk, "data", 4)) {
+			if (!have_format || !m_channels || m_block_align < m_channels * bits / 8)
+				return false;
+			if (format == WAV_FORMAT_PCM && bits == 16)
+				m_format = SF_S16;
+			else if (format == WAV_FORMAT_FLOAT && bits == 32)
+				m_format = SF_F32;
+			else
+				return false;
+
+			m_data_start = std::ftell(m_file);
+			/* Streamed files don't know their size, that's everything up to the end */
+			uint64_t bytes = size;
+			if (size == UINT32_MAX) {
+				std::fseek(m_file, 0, SEEK_END);
+				bytes = static_cast<uint64_t>(std::ftell(m_file) - m_data_start);
+				std::fseek(m_file, m_data_start, SEEK_SET);
+			}
+			m_frames = bytes / m_block_align;
+			return true;
+		} else {
+			/* Chunks are padded to an even size */
+			std::fseek(m_file, size + (size & 1), SEEK_CUR);
+		}
+	}
+}
+
+void pcm_file::close()
+{
+	if (m_file)
+		std::fclose(m_file);
+	m_file = nullptr;
+	m_frames = m_position = 0;
+}
+
+size_t pcm_file::read(float *left, float *right, size_t frames)
+{
+	if (!m_file)
+		return 0;
+
+	frames = static_cast<size_t>(UTIL_MIN(static_cast<uint64_t>(frames), m_frames - m_position));
+	m_chunk.resize(UTIL_MAX(m_chunk.size(), frames * m_block_align));
+	frames = std::fread(m_chunk.data(), m_block_align, frames, m_file);
+	m_position += frames;
+
+	const auto right_offset = m_channels > 1 ? (m_format == SF_S16 ? 2 : 4) : 0;
+	const auto scale = static_cast<float>(1.0 / constants::pcm_scale);
+
+	for (size_t i = 0; i < frames; i++) {
+		const auto *frame = m_chunk.data() + i * m_block_align;
+		if (m_format == SF_S16) {
+			left[i] = static_cast<int16_t>(read_u16(frame)) * scale;
+			right[i] = static_cast<int16_t>(read_u16(frame + right_offset)) * scale;
+		} else {
+			std::memcpy(left + i, frame, sizeof(float));
+			std::memcpy(right + i, frame + right_offset, sizeof(float));
+		}
+	}
+	return frames;
+}
+
+bool pcm_file::rewind()
+{
+	if (!m_file)
+		return false;
+	m_position = 0;
+	return std::fseek(m_file, m_data_start, SEEK_SET) == 0;
+}
+
+}
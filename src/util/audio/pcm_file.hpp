@@ -0,0 +1,64 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "../core.hpp"
+#include <cstdio>
+#include <vector>
+
+namespace audio {
+
+/* Reads 16 bit or float wav files, or headerless interleaved 16 bit
+ * stereo (raw s16le), into planar float buffers with obs' full scale of 1.
+ * Only little endian hosts are supported */
+class pcm_file {
+	enum sample_format { SF_S16, SF_F32 };
+
+	FILE *m_file = nullptr;
+	sample_format m_format = SF_S16;
+	uint32_t m_sample_rate = 0;
+	uint16_t m_channels = 0;
+	uint16_t m_block_align = 0; /* Bytes per frame of all channels */
+	long m_data_start = 0;
+	uint64_t m_frames = 0, m_position = 0;
+	std::vector<uint8_t> m_chunk; /* Bytes of the last read, kept to avoid allocating */
+
+	bool read_wav_header();
+
+public:
+	pcm_file() = default;
+	~pcm_file();
+	pcm_file(const pcm_file &) = delete;
+	pcm_file &operator=(const pcm_file &) = delete;
+
+	/* Opens a wav file, or a raw file at raw_sample_rate if raw is set */
+	bool open(const char *path, bool raw = false, uint32_t raw_sample_rate = defaults::sample_rate);
+	void close();
+
+	/* Reads up to frames frames, mono files are copied into both channels and
+	 * only the first two channels are used otherwise. Zero at the end */
+	size_t read(float *left, float *right, size_t frames);
+	bool rewind();
+
+	bool is_open() const { return m_file != nullptr; }
+	uint32_t sample_rate() const { return m_sample_rate; }
+	uint16_t channels() const { return m_channels; }
+	uint64_t frames() const { return m_frames; }
+};
+
+}
@@ -0,0 +1,125 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "render_backend.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace audio {
+
+vertex_buffer render_recorder::create_vertex_buffer(size_t vertices)
+{
+	m_buffers.emplace_back(vertices);
+	auto id = static_cast<vertex_buffer>(m_buffers.size());
+
+	render_command cmd{RO_CREATE};
+	cmd.buffer = id;
+	cmd.count = vertices;
+	m_commands.push_back(cmd);
+	++m_counts[RO_CREATE];
+	return id;
+}
+
+void render_recorder::destroy_vertex_buffer(vertex_buffer buffer)
+{
+	if (!buffer || buffer > m_buffers.size())
+		return;
+	m_buffers[buffer - 1] = vertexv();
+
+	render_command cmd{RO_DESTROY};
+	cmd.buffer = buffer;
+	m_commands.push_back(cmd);
+	++m_counts[RO_DESTROY];
+}
+
+void render_recorder::upload(vertex_buffer buffer, const vertex *vertices, size_t count)
+{
+	if (!buffer || buffer > m_buffers.size())
+		return;
+	auto &contents = m_buffers[buffer - 1];
+	count = std::min(count, contents.size());
+	std::copy(vertices, vertices + count, contents.begin());
+
+	render_command cmd{RO_UPLOAD};
+	cmd.buffer = buffer;
+	cmd.count = count;
+	m_commands.push_back(cmd);
+	++m_counts[RO_UPLOAD];
+}
+
+void render_recorder::draw(vertex_buffer buffer, draw_mode mode, size_t first, size_t count)
+{
+	if (!buffer || buffer > m_buffers.size())
+		return;
+	const auto &contents = m_buffers[buffer - 1];
+	first = std::min(first, contents.size());
+	count = std::min(count, contents.size() - first);
+
+	render_command cmd{RO_DRAW};
+	cmd.buffer = buffer;
+	cmd.mode = mode;
+	cmd.first = first;
+	cmd.count = count;
+	cmd.stream_offset = m_stream.size();
+	m_stream.insert(m_stream.end(), contents.begin() + first, contents.begin() + first + count);
+	m_commands.push_back(cmd);
+	++m_counts[RO_DRAW];
+	m_vertices_drawn += count;
+}
+
+void render_recorder::push_matrix()
+{
+	++m_matrix_depth;
+	m_commands.push_back(render_command{RO_PUSH_MATRIX});
+	++m_counts[RO_PUSH_MATRIX];
+}
+
+void render_recorder::translate(float x, float y)
+{
+	render_command cmd{RO_TRANSLATE};
+	cmd.x = x;
+	cmd.y = y;
+	m_commands.push_back(cmd);
+	++m_counts[RO_TRANSLATE];
+}
+
+void render_recorder::pop_matrix()
+{
+	if (!m_matrix_depth)
+		warn("Render recorder: matrix popped more often than pushed");
+	else
+		--m_matrix_depth;
+	m_commands.push_back(render_command{RO_POP_MATRIX});
+	++m_counts[RO_POP_MATRIX];
+}
+
+void render_recorder::clear()
+{
+	m_commands.clear();
+	m_stream.clear();
+	std::fill(std::begin(m_counts), std::end(m_counts), 0);
+	m_vertices_drawn = 0;
+}
+
+size_t render_recorder::live_buffers() const
+{
+	return static_cast<size_t>(
+		std::count_if(m_buffers.begin(), m_buffers.end(), [](const vertexv &b) { return !b.empty(); }));
+}
+
+}
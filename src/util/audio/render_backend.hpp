@@ -0,0 +1,92 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "geometry.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace audio {
+
+enum draw_mode { DM_TRIS, DM_TRISTRIP, DM_LINESTRIP };
+
+/* Vertex buffers are referred to by id, zero is none */
+using vertex_buffer = uint32_t;
+
+/* What the renderers draw through. The obs backend hands everything to
+ * libobs, the recorder keeps it in memory, so that rendering can be
+ * measured and checked without a gpu */
+class render_backend {
+public:
+	virtual ~render_backend() = default;
+
+	/* Dynamic buffers of a fixed size, meant to be rewritten every frame */
+	virtual vertex_buffer create_vertex_buffer(size_t vertices) = 0;
+	virtual void destroy_vertex_buffer(vertex_buffer buffer) = 0;
+	/* Replaces the first count vertices */
+	virtual void upload(vertex_buffer buffer, const vertex *vertices, size_t count) = 0;
+	virtual void draw(vertex_buffer buffer, draw_mode mode, size_t first, size_t count) = 0;
+
+	virtual void push_matrix() = 0;
+	virtual void translate(float x, float y) = 0;
+	virtual void pop_matrix() = 0;
+};
+
+enum render_op { RO_CREATE, RO_DESTROY, RO_UPLOAD, RO_DRAW, RO_PUSH_MATRIX, RO_TRANSLATE, RO_POP_MATRIX, RO_COUNT };
+
+struct render_command {
+	render_op op;
+	vertex_buffer buffer = 0;
+	draw_mode mode = DM_TRIS;
+	size_t first = 0, count = 0; /* Vertices, for creating only the count */
+	size_t stream_offset = 0;    /* Where a draw's vertices start in the stream */
+	float x = 0.f, y = 0.f;      /* Translation */
+};
+
+/* Records commands instead of drawing. Every draw copies the vertices it
+ * uses into one stream, so that they can be looked at after later uploads */
+class render_recorder : public render_backend {
+	std::vector<render_command> m_commands;
+	std::vector<vertexv> m_buffers; /* By id - 1, destroyed ones are empty */
+	vertexv m_stream;
+	size_t m_counts[RO_COUNT] = {};
+	size_t m_vertices_drawn = 0, m_matrix_depth = 0;
+
+public:
+	vertex_buffer create_vertex_buffer(size_t vertices) override;
+	void destroy_vertex_buffer(vertex_buffer buffer) override;
+	void upload(vertex_buffer buffer, const vertex *vertices, size_t count) override;
+	void draw(vertex_buffer buffer, draw_mode mode, size_t first, size_t count) override;
+
+	void push_matrix() override;
+	void translate(float x, float y) override;
+	void pop_matrix() override;
+
+	/* Forgets commands and counts, but keeps buffers and capacity */
+	void clear();
+
+	const std::vector<render_command> &commands() const { return m_commands; }
+	size_t count(render_op op) const { return m_counts[op]; }
+	size_t vertices_drawn() const { return m_vertices_drawn; }
+	size_t live_buffers() const;
+
+	/* The vertices of a recorded draw */
+	const vertex *vertices(const render_command &draw) const { return m_stream.data() + draw.stream_offset; }
+};
+
+}
@@ -0,0 +1,70 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "replay.hpp"
+#include "../../source/visualizer_source.hpp"
+
+namespace audio {
+
+replay::replay(source::config *cfg) : audio_source(cfg)
+{
+	update();
+}
+
+void replay::update()
+{
+	if (m_path != m_cfg->replay_path) {
+		m_path = m_cfg->replay_path;
+		if (m_path.empty())
+			m_file.close();
+		else
+			m_file.open(m_path.c_str());
+	}
+
+	/* The file decides the sample rate, like obs does for internal audio */
+	if (m_file.is_open()) {
+		m_cfg->sample_rate = m_file.sample_rate();
+		m_cfg->sample_size = m_cfg->sample_rate / m_cfg->fps;
+	}
+}
+
+bool replay::tick(float seconds)
+{
+	UNUSED_PARAMETER(seconds);
+	if (!m_file.is_open())
+		return false;
+
+	size_t read = 0;
+	bool rewound = false;
+	while (read < m_cfg->sample_size) {
+		auto count = m_file.read(m_cfg->buffer[0] + read, m_cfg->buffer[1] + read, m_cfg->sample_size - read);
+		if (count) {
+			read += count;
+			rewound = false;
+			continue;
+		}
+
+		/* Start over at the end of the file, give up if that doesn't help */
+		if (rewound || !m_file.rewind())
+			return false;
+		rewound = true;
+	}
+	return true;
+}
+
+}
@@ -0,0 +1,40 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "audio_source.hpp"
+#include "pcm_file.hpp"
+#include <string>
+
+namespace audio {
+
+/* Plays a wav file in a loop, one buffer per tick, so what a visualizer
+ * does with known input can be reproduced. spectralizer_replay reads
+ * files the same way without obs */
+class replay : public audio_source {
+	std::string m_path;
+	pcm_file m_file;
+
+public:
+	explicit replay(source::config *cfg);
+
+	void update() override;
+	bool tick(float seconds) override;
+};
+
+}
@@ -0,0 +1,211 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "smoothing.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace audio {
+
+void monstercat_smooth_reference(realv *bars, const realv &weights, fft_real min_height)
+{
+	auto bars_length = static_cast<int64_t>(bars->size());
+
+	// apply monstercat sytle smoothing
+	// Since this type of smoothing smoothes the bars around it, doesn't make
+	// sense to smooth the first value so skip it.
+	for (auto i = 1l; i < bars_length; ++i) {
+		auto outer_index = static_cast<size_t>(i);
+
+		if ((*bars)[outer_index] < min_height) {
+			(*bars)[outer_index] = min_height;
+		} else {
+			for (int64_t j = 0; j < bars_length; ++j) {
+				if (i != j) {
+					const auto index = static_cast<size_t>(j);
+					const auto weighted_value = (*bars)[outer_index] / weights[static_cast<size_t>(std::abs(i - j))];
+
+					// Note: do not use max here, since it's actually slower.
+					// Separating the assignment from the comparison avoids an
+					// unneeded assignment when (*bars)[index] is the largest
+					// which
+					// is often
+					if ((*bars)[index] < weighted_value)
+						(*bars)[index] = weighted_value;
+				}
+			}
+		}
+	}
+}
+
+/* Largest contribution of the candidates to the bar at index, candidates
+ * that have fallen too far behind to ever be the largest again are dropped.
+ * With exact geometric weights the ratio between two candidates never changes,
+ * rounding of the weights and the division can only move it by a few ulps */
+static fft_real strongest(std::vector<uint32_t> *candidates, const realv &sources, const realv &weights, size_t index)
+{
+	static const fft_real keep = 1 - 64 * std::numeric_limits<fft_real>::epsilon();
+	auto distance = [index](uint32_t c) { return c < index ? index - c : c - index; };
+	fft_real best = 0;
+
+	for (auto c : *candidates) {
+		const fft_real value = sources[c] / weights[distance(c)];
+		if (best < value)
+			best = value;
+	}
+
+	/* Weights never decrease, so once a candidate's contribution
+	 * has dropped to zero it stays there */
+	size_t alive = 0;
+	for (auto c : *candidates) {
+		const fft_real value = sources[c] / weights[distance(c)];
+		if (value > 0 && !(value < best * keep))
+			(*candidates)[alive++] = c;
+	}
+	candidates->resize(alive);
+	return best;
+}
+
+/* A newer candidate is closer to every bar that follows, so with
+ * weights that never decrease it beats all older ones that aren't larger */
+static void add_candidate(std::vector<uint32_t> *candidates, const realv &sources, uint32_t index)
+{
+	while (!candidates->empty() && sources[candidates->back()] <= sources[index])
+		candidates->pop_back();
+	candidates->emplace_back(index);
+}
+
+void monstercat_smooth(realv *bars, const realv &weights, fft_real min_height, monstercat_scratch *scratch)
+{
+	const auto n = bars->size();
+	if (n < 2)
+		return;
+
+	for (size_t i = 1; i < n; ++i) {
+		if (!(weights[i] >= weights[i - 1]) || !(weights[i - 1] > 0)) {
+			monstercat_smooth_reference(bars, weights, min_height);
+			return;
+		}
+	}
+
+	auto &bar = *bars;
+	auto &sources = scratch->sources;
+	auto &candidates = scratch->candidates;
+	sources.assign(n, 0);
+	candidates.clear();
+
+	/* Left to right: a bar only spreads what it has when its turn comes,
+	 * which includes everything spread to it from the left. Bars are
+	 * magnitudes, so spreading zero can't change anything */
+	for (uint32_t i = 1; i < n; ++i) {
+		const auto from_left = strongest(&candidates, sources, weights, i);
+		if (bar[i] < from_left)
+			bar[i] = from_left;
+
+		if (bar[i] < min_height) {
+			bar[i] = min_height;
+		} else if (bar[i] > 0) {
+			sources[i] = bar[i];
+			add_candidate(&candidates, sources, i);
+		}
+	}
+
+	/* Right to left: everything spread by bars that came later */
+	candidates.clear();
+	for (auto i = static_cast<uint32_t>(n); i-- > 0;) {
+		const auto from_right = strongest(&candidates, sources, weights, i);
+		if (bar[i] < from_right)
+			bar[i] = from_right;
+
+		if (sources[i] > 0)
+			add_candidate(&candidates, sources, i);
+	}
+}
+
+void sgs_smooth_reference(realv *bars, uint32_t points, uint32_t passes)
+{
+	auto original_bars = *bars;
+
+	for (auto pass = 0u; pass < passes; ++pass) {
+		auto pivot = static_cast<uint32_t>(std::floor(points / 2.0));
+
+		for (auto i = 0u; i < pivot; ++i) {
+			(*bars)[i] = original_bars[i];
+			(*bars)[original_bars.size() - i - 1] = original_bars[original_bars.size() - i - 1];
+		}
+
+		auto smoothing_constant = 1.0 / (2.0 * pivot + 1.0);
+		for (auto i = pivot; i < (original_bars.size() - pivot); ++i) {
+			auto sum = 0.0;
+			for (auto j = 0u; j <= (2 * pivot); ++j) {
+				sum += (smoothing_constant * original_bars[i + j - pivot]) + j - pivot;
+			}
+			(*bars)[i] = sum;
+		}
+
+		// prepare for next pass
+		if (pass < (passes - 1)) {
+			original_bars = *bars;
+		}
+	}
+}
+
+void sgs_smooth(realv *bars, uint32_t points, uint32_t passes, realv *scratch)
+{
+	const auto n = bars->size();
+	const size_t pivot = points / 2;
+	if (!passes || !n)
+		return;
+
+	/* The reference adds j - pivot for every bar in the window, which sums
+	 * up to zero, so leaving it out only changes rounding */
+	const auto smoothing_constant = 1.0 / (2.0 * pivot + 1.0);
+	const auto edge = std::min(pivot, n);
+	scratch->resize(n);
+	realv *in = bars, *out = scratch;
+
+	for (auto pass = 0u; pass < passes; ++pass) {
+		for (size_t i = 0; i < edge; ++i) {
+			(*out)[i] = (*in)[i];
+			(*out)[n - i - 1] = (*in)[n - i - 1];
+		}
+
+		if (n > 2 * pivot) {
+			auto sum = 0.0;
+			for (size_t i = 0; i <= 2 * pivot; ++i)
+				sum += (*in)[i];
+
+			for (auto i = pivot;; ++i) {
+				(*out)[i] = smoothing_constant * sum;
+				if (i + pivot + 1 >= n)
+					break;
+				sum += static_cast<double>((*in)[i + pivot + 1]) - (*in)[i - pivot];
+			}
+		}
+
+		std::swap(in, out);
+	}
+
+	/* Swapping hands the buffers over without copying */
+	if (in != bars)
+		bars->swap(*scratch);
+}
+
+}
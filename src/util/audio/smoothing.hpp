@@ -0,0 +1,50 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "fft.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace audio {
+
+/* Reused between frames, so monstercat_smooth doesn't allocate */
+struct monstercat_scratch {
+	std::vector<uint32_t> candidates;
+	realv sources; /* Value a bar spreads to its neighbours, zero if it doesn't */
+};
+
+/* Original O(n²) monstercat smoothing. From left to right every bar below
+ * min_height is raised to it, every other bar raises all others to
+ * bar / weights[distance]. The first bar is never spread */
+void monstercat_smooth_reference(realv *bars, const realv &weights, fft_real min_height);
+
+/* Gives bit for bit the same result as the reference in two linear sweeps.
+ * Only the bars that can still be the largest contribution are tracked,
+ * which needs weights that never decrease, otherwise the reference is used */
+void monstercat_smooth(realv *bars, const realv &weights, fft_real min_height, monstercat_scratch *scratch);
+
+/* Original sgs smoothing, every pass replaces each bar with the average of
+ * the points bars around it, the first and last points / 2 bars are kept */
+void sgs_smooth_reference(realv *bars, uint32_t points, uint32_t passes);
+
+/* Same averages from a running sum, O(passes * n). Passes alternate between
+ * bars and scratch, which only allocates when the bar count changes */
+void sgs_smooth(realv *bars, uint32_t points, uint32_t passes, realv *scratch);
+
+}
@@ -0,0 +1,307 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "spectrum_analyzer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace audio {
+
+void spectrum_analyzer::configure(const analysis_settings &settings)
+{
+	m_settings = settings;
+	m_monstercat_smoothing_weights.clear(); /* Force recomputing of smoothing */
+
+	if (m_settings.transform)
+		m_fft.configure(m_settings.sample_size, m_settings.stereo, m_settings.stereo_packed, m_settings.fft_rigor);
+
+	/* Reserving keeps the sizes, which falloff uses to detect new bar counts */
+	const auto number_of_bars = m_settings.detail + DEAD_BAR_OFFSET;
+	recalculate_cutoff_frequencies(number_of_bars, &m_low_cutoff_frequencies, &m_high_cutoff_frequencies,
+								   &m_frequency_constants_per_bin);
+	m_last_bar_count = number_of_bars;
+
+	for (auto *bars : {&m_bars_left, &m_bars_right, &m_bars_left_new, &m_bars_right_new, &m_bars_falloff_left,
+					   &m_bars_falloff_right, &m_monstercat_smoothing_weights, &m_sgs_scratch,
+					   &m_monstercat_scratch.sources})
+		bars->reserve(number_of_bars);
+	m_monstercat_scratch.candidates.reserve(number_of_bars);
+
+	const auto window = auto_scale_window();
+	if (m_previous_max_heights.capacity() != window + 1) {
+		m_previous_max_heights.reset(window + 1,
+									 static_cast<size_t>(constants::auto_scaling_reset_window * window));
+	}
+}
+
+const spectrum *spectrum_analyzer::transform(const float *in_left, const float *in_right)
+{
+	if (!m_settings.transform || !m_fft.process(in_left, in_right, &m_profile))
+		return nullptr;
+	return &m_fft.result();
+}
+
+void spectrum_analyzer::analyze(const spectrum &spec)
+{
+	auto height = static_cast<int32_t>(m_settings.bar_height);
+	double grav = 1 - m_settings.gravity;
+
+	if (m_settings.stereo)
+		height /= 2;
+
+	create_spectrum_bars(spec.left, height, m_settings.detail + DEAD_BAR_OFFSET, &m_bars_left_new,
+						 &m_bars_falloff_left);
+	if (m_settings.stereo) {
+		create_spectrum_bars(spec.right, height, m_settings.detail + DEAD_BAR_OFFSET, &m_bars_right_new,
+							 &m_bars_falloff_right);
+
+		m_bars_right.resize(m_bars_right_new.size(), 0.0);
+		for (size_t i = 0; i < m_bars_right.size(); i++) {
+			m_bars_right[i] = m_bars_right[i] * m_settings.gravity + m_bars_right_new[i] * grav;
+		}
+	}
+
+	m_bars_left.resize(m_bars_left_new.size(), 0.0);
+	for (size_t i = 0; i < m_bars_left.size(); i++) {
+		m_bars_left[i] = m_bars_left[i] * m_settings.gravity + m_bars_left_new[i] * grav;
+	}
+}
+
+bool spectrum_analyzer::sleeping(float seconds)
+{
+	if (m_sleeping) {
+		m_sleep_count += seconds;
+		if (m_sleep_count >= 0.25f) {
+			m_sleeping = false;
+			m_sleep_count = 0.f;
+		}
+		return true;
+	}
+	return false;
+}
+
+bool spectrum_analyzer::analyze_audible(const spectrum &spec)
+{
+	bool is_silent_left = spec.stats_left.silent;
+	bool is_silent_right = !m_settings.stereo || spec.stats_right.silent;
+
+	if (!(is_silent_left && is_silent_right)) {
+		m_silent_runs = 0;
+	} else {
+		++m_silent_runs;
+	}
+
+	/* TODO make this a constant */
+	if (m_silent_runs < 30) {
+		analyze(spec);
+		return true;
+	}
+	m_sleeping = true;
+	return false;
+}
+
+size_t spectrum_analyzer::auto_scale_window() const
+{
+	// max number of elements to calculate for moving average
+	return static_cast<size_t>(
+		((constants::auto_scale_span * m_settings.sample_rate) / (static_cast<double>(m_settings.sample_size))) * 2.0);
+}
+
+void spectrum_analyzer::smooth_bars(realv *bars)
+{
+	switch (m_settings.smoothing) {
+	case SM_MONSTERCAT:
+		monstercat_smoothing(bars);
+		break;
+	case SM_SGS:
+		sgs_smoothing(bars);
+		break;
+	default:;
+	}
+}
+
+void spectrum_analyzer::sgs_smoothing(realv *bars)
+{
+	sgs_smooth(bars, m_settings.sgs_points, m_settings.sgs_passes, &m_sgs_scratch);
+}
+
+void spectrum_analyzer::monstercat_smoothing(realv *bars)
+{
+	// re-compute weights if needed, this is a performance tweak to computer the
+	// smoothing considerably faster
+	if (m_monstercat_smoothing_weights.size() != bars->size()) {
+		m_monstercat_smoothing_weights.resize(bars->size());
+		for (auto i = 0u; i < bars->size(); ++i) {
+			m_monstercat_smoothing_weights[i] = std::pow(m_settings.mcat_smoothing_factor, i);
+		}
+	}
+
+	monstercat_smooth(bars, m_monstercat_smoothing_weights, m_settings.bar_min_height, &m_monstercat_scratch);
+}
+
+void spectrum_analyzer::apply_falloff(const realv &bars, realv *falloff_bars) const
+{
+	// Screen size has change which means previous falloff values are not valid
+	if (falloff_bars->size() != bars.size()) {
+		*falloff_bars = bars;
+		return;
+	}
+
+	for (auto i = 0u; i < bars.size(); ++i) {
+		// falloff should always by at least one
+		auto falloff_value = std::min<fft_real>((*falloff_bars)[i] * m_settings.falloff_weight, (*falloff_bars)[i] - 1);
+
+		(*falloff_bars)[i] = std::max(falloff_value, bars[i]);
+	}
+}
+
+void spectrum_analyzer::calculate_moving_average_and_std_dev(double new_value, util::rolling_stats *old_values,
+															 double *moving_average, double *std_dev) const
+{
+	old_values->push(new_value);
+	*moving_average = old_values->mean();
+	*std_dev = old_values->std_dev();
+}
+
+void spectrum_analyzer::scale_bars(int32_t height, realv *bars)
+{
+	if (bars->empty())
+		return;
+
+	if (m_settings.use_auto_scale) {
+		const auto max_height_iter = std::max_element(bars->begin(), bars->end());
+
+		/* The window is sized in update() and holds one value more than this */
+		const auto max_number_of_elements = auto_scale_window();
+
+		double std_dev = 0.0;
+		double moving_average = 0.0;
+		calculate_moving_average_and_std_dev(*max_height_iter, &m_previous_max_heights, &moving_average, &std_dev);
+
+		util::maybe_reset_scaling_window(*max_height_iter, max_number_of_elements, &m_previous_max_heights,
+										 &moving_average, &std_dev);
+
+		auto max_height = moving_average + (2 * std_dev);
+		// avoid division by zero when
+		// height is zero, this happens when
+		// the sound is muted
+		max_height = std::max(max_height, 1.0);
+
+		for (fft_real &bar : *bars) {
+			bar = std::min(static_cast<double>(height - 1), ((bar / max_height) * height) - 1);
+		}
+	} else {
+		for (fft_real &bar : *bars) {
+			bar *= m_settings.scale_size;
+			bar += m_settings.scale_boost;
+		}
+	}
+}
+
+void spectrum_analyzer::create_spectrum_bars(const realv &magnitudes, int32_t win_height, uint32_t number_of_bars,
+											 realv *bars, realv *bars_falloff)
+{
+	// cut off frequencies only have to be re-calculated if number of bars
+	// change
+	if (m_last_bar_count != number_of_bars) {
+		recalculate_cutoff_frequencies(number_of_bars, &m_low_cutoff_frequencies, &m_high_cutoff_frequencies,
+									   &m_frequency_constants_per_bin);
+		m_last_bar_count = number_of_bars;
+	}
+
+	// Separate the frequency spectrum into bars, the number of bars is based on
+	// screen width
+	util::stage_timer timer(&m_profile, util::PS_BINNING);
+	generate_bars(magnitudes, bars);
+
+	// smoothing
+	timer.lap(util::PS_SMOOTHING);
+	smooth_bars(bars);
+
+	// scale bars
+	timer.lap(util::PS_SCALING);
+	scale_bars(win_height, bars);
+
+	// falloff, save values for next falloff run
+	timer.lap(util::PS_FALLOFF);
+	apply_falloff(*bars, bars_falloff);
+}
+
+void spectrum_analyzer::recalculate_cutoff_frequencies(uint32_t number_of_bars, uint32v *low_cutoff_frequencies,
+													   uint32v *high_cutoff_frequencies, doublev *freqconst_per_bin)
+{
+	auto freq_const =
+		std::log10((m_settings.low_cutoff_freq / m_settings.high_cutoff_freq)) / ((1.0 / number_of_bars + 1.0) - 1.0);
+
+	(*low_cutoff_frequencies) = std::vector<uint32_t>(number_of_bars + 1);
+	(*high_cutoff_frequencies) = std::vector<uint32_t>(number_of_bars + 1);
+	(*freqconst_per_bin) = std::vector<double>(number_of_bars + 1);
+
+	for (auto i = 0u; i <= number_of_bars; i++) {
+		(*freqconst_per_bin)[i] =
+			static_cast<double>(m_settings.high_cutoff_freq) *
+			std::pow(10.0, (freq_const * -1) + (((i + 1.0) / (number_of_bars + 1.0)) * freq_const));
+
+		auto frequency = (*freqconst_per_bin)[i] / (m_settings.sample_rate / 2.0);
+
+		(*low_cutoff_frequencies)[i] =
+			static_cast<uint32_t>(std::floor(frequency * static_cast<double>(m_settings.sample_size) / 4.0));
+
+		if (i > 0) {
+			if ((*low_cutoff_frequencies)[i] <= (*low_cutoff_frequencies)[i - 1]) {
+				(*low_cutoff_frequencies)[i] = (*low_cutoff_frequencies)[i - 1] + 1;
+			}
+			(*high_cutoff_frequencies)[i - 1] = (*low_cutoff_frequencies)[i - 1];
+		}
+	}
+
+	/* Everything that only depends on the bar index is done
+	 * here, so generate_bars() is just one pass over the bins */
+	m_bar_bins.resize(number_of_bars);
+	for (auto i = 0u; i < number_of_bars; i++) {
+		auto &bins = m_bar_bins[i];
+		bins.first = (*low_cutoff_frequencies)[i];
+		bins.count = (*high_cutoff_frequencies)[i] - bins.first + 1;
+
+		/* boost high freqs */
+		bins.weight = static_cast<fft_real>(std::log2(2 + i) * (100.f / number_of_bars) / bins.count);
+	}
+}
+
+void spectrum_analyzer::generate_bars(const realv &magnitudes, realv *bars) const
+{
+	const auto results = static_cast<uint32_t>(magnitudes.size());
+	const auto *magnitude = magnitudes.data();
+
+	if (bars->size() != m_bar_bins.size()) {
+		bars->resize(m_bar_bins.size(), 0.0);
+	}
+
+	for (size_t i = 0; i < m_bar_bins.size(); i++) {
+		const auto &bins = m_bar_bins[i];
+		/* Cutoffs can lie past the last bin for low sample sizes */
+		auto first = UTIL_MIN(bins.first, results);
+		auto last = UTIL_MIN(bins.first + bins.count, results);
+
+		fft_real freq_magnitude = 0.0;
+		for (auto bin = first; bin < last; ++bin)
+			freq_magnitude += magnitude[bin];
+		(*bars)[i] = std::sqrt(freq_magnitude * bins.weight);
+	}
+}
+}
@@ -0,0 +1,152 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "../core.hpp"
+#include "../profiler.hpp"
+#include "../rolling_stats.hpp"
+#include "fft_stage.hpp"
+#include "smoothing.hpp"
+#include <vector>
+
+#define DEAD_BAR_OFFSET 5 /* The last five bars seem to always be silent, so we cut them off */
+
+/* Save some writing */
+using doublev = std::vector<double>;
+using uint32v = std::vector<uint32_t>;
+
+namespace audio {
+
+/* The fft bins summed into one bar and what the sum is scaled by */
+struct bar_bins {
+	uint32_t first = 0, count = 0;
+	fft_real weight = 0; /* Averaging and high frequency boost folded into one */
+};
+
+/* The part of a visualizer's settings that the analysis depends on,
+ * field names match source::config */
+struct analysis_settings {
+	/* Audio settings */
+	uint32_t sample_rate = defaults::sample_rate;
+	uint32_t sample_size = defaults::sample_size;
+	bool stereo = defaults::stereo;
+	bool stereo_packed = defaults::stereo_packed;
+	enum fft_rigor fft_rigor = defaults::fft_rigor;
+	/* False if spectra come from elsewhere (e.g. the capture hub),
+	 * then transform() isn't used and no fft buffers are allocated */
+	bool transform = true;
+
+	uint16_t detail = defaults::detail;
+	double low_cutoff_freq = defaults::lfreq_cut;
+	double high_cutoff_freq = defaults::hfreq_cut;
+
+	/* smoothing */
+	smooting_mode smoothing = defaults::smoothing;
+	uint32_t sgs_points = defaults::sgs_points, sgs_passes = defaults::sgs_passes;
+	double mcat_smoothing_factor = defaults::mcat_smooth;
+
+	/* scaling */
+	bool use_auto_scale = defaults::use_auto_scale;
+	double scale_boost = defaults::scale_boost;
+	double scale_size = defaults::scale_size;
+	uint16_t bar_height = defaults::bar_height;
+	uint16_t bar_min_height = defaults::bar_min_height;
+
+	double falloff_weight = defaults::falloff_weight;
+	double gravity = defaults::gravity;
+};
+
+/* Everything between audio and bar heights: pcm conversion, fft, binning,
+ * smoothing, scaling, falloff and gravity. Doesn't depend on libobs, the
+ * visualizers only feed it audio and draw what comes out */
+class spectrum_analyzer {
+	analysis_settings m_settings;
+	fft_stage m_fft;
+
+	/* New values are smoothly copied over if smoothing is used
+	 * otherwise they're directly copied */
+	realv m_bars_left, m_bars_right, m_bars_left_new, m_bars_right_new;
+	realv m_bars_falloff_left, m_bars_falloff_right;
+
+	uint32_t m_last_bar_count = 0;
+
+	/* Frequency cutoff variables */
+	uint32v m_low_cutoff_frequencies;
+	uint32v m_high_cutoff_frequencies;
+	doublev m_frequency_constants_per_bin;
+	/* Offset table built from the cutoffs, one entry per bar */
+	std::vector<bar_bins> m_bar_bins;
+
+	util::rolling_stats m_previous_max_heights; /* Of both channels */
+	realv m_monstercat_smoothing_weights;
+	monstercat_scratch m_monstercat_scratch;
+	realv m_sgs_scratch;
+
+	util::stage_profile m_profile;
+
+	bool m_sleeping = false;
+	float m_sleep_count = 0.f;
+	uint64_t m_silent_runs = 0; /* determines sleep state */
+
+	void create_spectrum_bars(const realv &magnitudes, int32_t win_height, uint32_t number_of_bars, realv *bars,
+							  realv *bars_falloff);
+	void recalculate_cutoff_frequencies(uint32_t number_of_bars, uint32v *low_cutoff_frequencies,
+										uint32v *high_cutoff_frequencies, doublev *freqconst_per_bin);
+	void calculate_moving_average_and_std_dev(double new_value, util::rolling_stats *old_values,
+											  double *moving_average, double *std_dev) const;
+	size_t auto_scale_window() const;
+	void sgs_smoothing(realv *bars);
+	void monstercat_smoothing(realv *bars);
+
+public:
+	/* Sizes everything analyze() and transform() touch, so that they never
+	 * have to allocate. Bars, falloff and the auto scale window are kept
+	 * as long as the settings still fit them */
+	void configure(const analysis_settings &settings);
+
+	/* Transforms sample_size samples of each channel, in_right is only read
+	 * in stereo. Null if there's no plan or configured without transform */
+	const spectrum *transform(const float *in_left, const float *in_right);
+
+	/* Turns a spectrum into bars, blended with the previous ones by gravity */
+	void analyze(const spectrum &spec);
+
+	/* Called first in every tick with the time since the last one, true
+	 * while analysis is paused after silence and audio shouldn't be read */
+	bool sleeping(float seconds);
+
+	/* analyze() unless silence lasted for a while, false if nothing
+	 * was analyzed because the analyzer went to sleep */
+	bool analyze_audible(const spectrum &spec);
+
+	const analysis_settings &settings() const { return m_settings; }
+	const realv &bars_left() const { return m_bars_left; }
+	const realv &bars_right() const { return m_bars_right; }
+	const realv &falloff_left() const { return m_bars_falloff_left; }
+	const realv &falloff_right() const { return m_bars_falloff_right; }
+	/* Stage timings of transform() and analyze(), callers can add their own stages */
+	util::stage_profile &profile() { return m_profile; }
+
+	/* The single steps of analyze(), so they can be timed on their own */
+	void generate_bars(const realv &magnitudes, realv *bars) const;
+	void smooth_bars(realv *bars);
+	void scale_bars(int32_t height, realv *bars);
+	void apply_falloff(const realv &bars, realv *falloff_bars) const;
+};
+
+}
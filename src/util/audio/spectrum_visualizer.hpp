@@ -17,69 +17,39 @@
  *************************************************************************/
 
 #pragma once
+#include "../triple_buffer.hpp"
 #include "../util.hpp"
 #include "audio_visualizer.hpp"
-#include <fftw3.h>
-#include <vector>
-
-#define DEAD_BAR_OFFSET 5 /* The last five bars seem to always be silent, so we cut them off */
-
-/* Save some writing */
-using doublev = std::vector<double>;
-using uint32v = std::vector<uint32_t>;
+#include "spectrum_analyzer.hpp"
 
 namespace audio {
 
-class spectrum_visualizer : public audio_visualizer {
-	uint32_t m_last_bar_count;
-	bool m_sleeping = false;
-	float m_sleep_count = 0.f;
-	/* fft calculation vars */
-	size_t m_fftw_results;
-	double *m_fftw_input_left;
-	double *m_fftw_input_right;
-
-	fftw_complex *m_fftw_output_left;
-	fftw_complex *m_fftw_output_right;
-
-	fftw_plan m_fftw_plan_left;
-	fftw_plan m_fftw_plan_right;
-
-	/* Frequency cutoff variables */
-	uint32v m_low_cutoff_frequencies;
-	uint32v m_high_cutoff_frequencies;
-	doublev m_frequency_constants_per_bin;
-
-	uint64_t m_silent_runs; /* determines sleep state */
-
-	bool prepare_fft_input(pcm_stereo_sample *buffer, uint32_t sample_size, double *fftw_input,
-						   channel_mode channel_mode);
+/* One finished analysis result, handed from tick() to render() */
+struct bar_frame {
+	uint64_t sequence = 0; /* Zero until the first frame was published */
+	realv left, right;
+	realv falloff_left, falloff_right;
+};
 
-	void create_spectrum_bars(fftw_complex *fftw_output, size_t fftw_results, int32_t win_height,
-							  uint32_t number_of_bars, doublev *bars, doublev *bars_falloff);
+class spectrum_visualizer : public audio_visualizer {
+	/* Turns audio into bars, this class only feeds it and hands results to render() */
+	spectrum_analyzer m_analyzer;
 
-	void generate_bars(uint32_t number_of_bars, size_t fftw_results, const uint32v &low_cutoff_frequencies,
-					   const uint32v &high_cutoff_frequencies, const fftw_complex *fftw_output, doublev *bars) const;
+	/* Finished bars are copied into the back frame and published, so
+	 * render() never waits for tick() or the other way around */
+	util::triple_buffer<bar_frame> m_frames;
+	uint64_t m_sequence = 0;
+	/* Only touched by render() */
+	uint64_t m_rendered_sequence = 0, m_frames_dropped = 0, m_frames_repeated = 0;
 
-	void recalculate_cutoff_frequencies(uint32_t number_of_bars, uint32v *low_cutoff_frequencies,
-										uint32v *high_cutoff_frequencies, doublev *freqconst_per_bin);
-	void smooth_bars(doublev *bars);
-	void apply_falloff(const doublev &bars, doublev *falloff_bars) const;
-	void calculate_moving_average_and_std_dev(double new_value, size_t max_number_of_elements, doublev *old_values,
-											  double *moving_average, double *std_dev) const;
-	void maybe_reset_scaling_window(double current_max_height, size_t max_number_of_elements, doublev *values,
-									double *moving_average, double *std_dev);
-	void scale_bars(int32_t height, doublev *bars);
-	void sgs_smoothing(doublev *bars);
-	void monstercat_smoothing(doublev *bars);
+	void publish_frame();
 
 protected:
-	/* New values are smoothly copied over if smoothing is used
-     * otherwise they're directly copied */
-	doublev m_bars_left, m_bars_right, m_bars_left_new, m_bars_right_new;
-	doublev m_bars_falloff_left, m_bars_falloff_right;
-	doublev m_previous_max_heights;
-	doublev m_monstercat_smoothing_weights;
+	/* Called by render(), returns the newest published frame */
+	const bar_frame &acquire_frame();
+
+	/* For timing render()'s stages next to the analysis */
+	util::stage_profile &profile() { return m_analyzer.profile(); }
 
 public:
 	explicit spectrum_visualizer(source::config *cfg);
@@ -0,0 +1,76 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "wire_renderer.hpp"
+
+namespace audio {
+
+bool wire_renderer::reserve(render_backend &backend, size_t vertices)
+{
+	if (m_buffer_vertices >= vertices)
+		return true;
+
+	m_buffer_vertices = vertices;
+	for (auto &buffer : m_buffers) {
+		backend.destroy_vertex_buffer(buffer);
+		buffer = backend.create_vertex_buffer(vertices);
+		if (!buffer)
+			m_buffer_vertices = 0;
+	}
+	m_vertices.resize(vertices * 2);
+
+	if (!m_buffer_vertices && m_failed_vertices != vertices)
+		warn("Failed to create wire buffers for %zu vertices, not drawing", vertices);
+	m_failed_vertices = m_buffer_vertices ? 0 : vertices;
+	return m_buffer_vertices != 0;
+}
+
+void wire_renderer::render(render_backend &backend, const wire_layout &layout, const realv &left,
+						   const realv &right, util::stage_profile *profile)
+{
+	util::stage_timer timer(profile, util::PS_VERTICES);
+
+	const realv *bars[2] = {&left, &right};
+	const channel_mode channels[2] = {layout.stereo ? CM_LEFT : CM_BOTH, CM_RIGHT};
+	const auto channel_count = layout.stereo ? 2 : 1;
+
+	/* Detail or wire mode changed since the last frame, the
+	 * graphics context is already held here */
+	size_t needed = 0;
+	for (int i = 0; i < channel_count; i++)
+		needed = UTIL_MAX(needed, wire_vertex_count(layout.wire_mode, bars[i]->size()));
+	if (!reserve(backend, needed))
+		return;
+
+	size_t counts[2] = {};
+	for (int i = 0; i < channel_count; i++) {
+		counts[i] = build_wire_vertices(bars[i]->data(), bars[i]->size(), layout, channels[i],
+										m_vertices.data() + i * m_buffer_vertices);
+	}
+	timer.stop();
+
+	auto mode = layout.wire_mode == WM_THIN ? DM_LINESTRIP : DM_TRISTRIP;
+	for (int i = 0; i < channel_count; i++) {
+		if (!counts[i])
+			continue;
+		backend.upload(m_buffers[i], m_vertices.data() + i * m_buffer_vertices, counts[i]);
+		backend.draw(m_buffers[i], mode, 0, counts[i]);
+	}
+}
+
+}
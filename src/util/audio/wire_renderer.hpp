@@ -0,0 +1,42 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "../profiler.hpp"
+#include "render_backend.hpp"
+
+namespace audio {
+
+/* Draws wires from one buffer per channel. The buffers only grow, so
+ * they're made once per bar count and wire mode, from the render path */
+class wire_renderer {
+	vertex_buffer m_buffers[2] = {};
+	vertexv m_vertices; /* Both channels, uploaded into the buffers */
+	size_t m_buffer_vertices = 0;
+	size_t m_failed_vertices = 0; /* Size that couldn't be made, to only warn once */
+
+	/* False if the buffers couldn't be made */
+	bool reserve(render_backend &backend, size_t vertices);
+
+public:
+	/* right is only drawn in stereo, vertex generation is timed as PS_VERTICES */
+	void render(render_backend &backend, const wire_layout &layout, const realv &left, const realv &right,
+				util::stage_profile *profile = nullptr);
+};
+
+}
@@ -17,18 +17,19 @@
  *************************************************************************/
 
 #pragma once
+#include "obs_render_backend.hpp"
 #include "spectrum_visualizer.hpp"
+#include "wire_renderer.hpp"
 
 namespace audio {
 class wire_visualizer : public spectrum_visualizer {
-	gs_vertbuffer_t *make_thin(channel_mode cm);
-	gs_vertbuffer_t *make_thick(channel_mode cm);
-	gs_vertbuffer_t *make_filled(channel_mode cm);
-	gs_vertbuffer_t *make_filled_inverted(channel_mode cm);
+	/* Buffers are made while rendering, the backend owns them */
+	obs_render_backend m_backend;
+	wire_renderer m_renderer;
 
 public:
 	explicit wire_visualizer(source::config *cfg);
 
-	void render(gs_effect_t *e) override;
+	void render(gs_effect_t *e, const source::config *cfg) override;
 };
 }
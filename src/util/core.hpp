@@ -0,0 +1,181 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Logging, the levels match libobs' so the module can pass messages on as is */
+enum log_level
+{
+	LL_ERROR = 100,
+	LL_WARNING = 200,
+	LL_INFO = 300,
+	LL_DEBUG = 400
+};
+
+namespace util {
+using log_sink = void (*)(int level, const char *format, va_list args);
+
+/* Messages go to stderr until a sink is set, debug messages are dropped there */
+void set_log_sink(log_sink sink);
+void log(int level, const char *format, ...);
+}
+
+#define write_log(log_level, format, ...) util::log(log_level, "[spectralizer] " format, ##__VA_ARGS__)
+
+#define debug(format, ...) write_log(LL_DEBUG, format, ##__VA_ARGS__)
+#define info(format, ...) write_log(LL_INFO, format, ##__VA_ARGS__)
+#define warn(format, ...) write_log(LL_WARNING, format, ##__VA_ARGS__)
+
+/* clang-format off */
+
+#define UTIL_EULER 2.7182818284590452353
+#define UTIL_PI 3.14159265358979323846
+#define UTIL_SWAP(a, b) do { typeof(a) tmp = a; a = b; b = tmp; } while (0)
+#define UTIL_MAX(a, b)                  (((a) > (b)) ? (a) : (b))
+#define UTIL_MIN(a, b)                  (((a) < (b)) ? (a) : (b))
+#define UTIL_CLAMP(lower, x, upper) 	(UTIL_MIN(upper, UTIL_MAX(x, lower)))
+#define CACHE_LINE_SIZE                 64
+
+enum visual_mode
+{
+    VM_BARS, VM_WIRE
+};
+
+enum wire_mode
+{
+    WM_THIN, WM_THICK, WM_FILL, WM_FILL_INVERTED
+};
+
+enum smooting_mode
+{
+    SM_NONE = 0,
+    SM_MONSTERCAT,
+    SM_SGS
+};
+
+enum falloff
+{
+    FO_NONE = 0,
+    FO_FILL,
+    FO_TOP
+};
+
+/* How much time fftw may spend on finding a fast plan */
+enum fft_rigor
+{
+    FR_ESTIMATE = 0,
+    FR_MEASURE,
+    FR_PATIENT
+};
+
+enum channel_mode
+{
+    CM_LEFT = 0,
+    CM_RIGHT,
+    CM_BOTH
+};
+
+struct stereo_sample_frame
+{
+    int16_t l, r;
+};
+
+using pcm_stereo_sample = struct stereo_sample_frame;
+#define CNST			static const constexpr
+
+namespace defaults {
+    CNST bool			stereo			= false,
+                        stereo_packed	= false;
+    CNST visual_mode 	visual			= VM_BARS;
+    CNST smooting_mode	smoothing		= SM_NONE;
+    CNST uint32_t		color			= 0xffffffff;
+
+    CNST uint16_t		detail			= 32,
+                        cx				= 50,
+                        cy				= 50,
+                        fps				= 30;
+
+    CNST uint32_t		sample_rate		= 44100,
+                        sample_size 	= sample_rate / fps;
+
+    CNST double			lfreq_cut		= 30,
+                        hfreq_cut		= 22050,
+                        falloff_weight	= .95,
+                        gravity			= .8;
+    CNST uint32_t		sgs_points		= 3,		/* Should be a odd number */
+                        sgs_passes		= 2;
+
+    CNST double			mcat_smooth		= 1.5;
+
+    CNST uint16_t		bar_space		= 2,
+                        bar_width		= 5,
+                        bar_height		= 100,
+                        bar_min_height	= 5;
+
+    CNST uint16_t		wire_thickness	= 5;
+    CNST wire_mode		wire_mode		= WM_THIN;
+
+    CNST char			*fifo_path		= "/tmp/mpd.fifo";
+    CNST char			*audio_source	= "none";
+
+    CNST bool			use_auto_scale	= true;
+    CNST double			scale_boost		= 0.0;
+    CNST double			scale_size		= 1.0;
+
+    CNST fft_rigor		fft_rigor		= FR_MEASURE;
+    CNST bool			analysis_thread	= false;
+};
+
+namespace constants {
+    CNST int auto_scale_span 						= 30;
+    CNST double auto_scaling_reset_window			= 0.1;
+    CNST double auto_scaling_erase_percent 			= 0.75;
+    /* Amount of deviation needed between short term and long
+     * term moving max height averages to trigger an autoscaling reset */
+    CNST double deviation_amount_to_reset 			= 1.0;
+    /* Audio is analyzed in 16 bit range, which the bar scaling was tuned for */
+    CNST double pcm_scale							= UINT16_MAX / 2;
+    /* Max. relative error between packed and separate stereo ffts */
+    CNST double stereo_packing_tolerance			= 1e-3;
+    /* Lowest value of decibel spectra, silent bins would be -inf otherwise */
+    CNST double spectrum_db_floor					= -120.0;
+    /* Seconds fftw may spend on measuring a plan in the background */
+    CNST double fft_plan_time_limit					= 1.0;
+    /* Frames per channel the capture ring can hold, ~680ms at 48kHz */
+    CNST size_t audio_ring_frames					= 1 << 15;
+    /* Without new audio, analysis still runs this often on the pool
+     * to apply settings and let the bars fall, audio usually arrives every ~20ms */
+    CNST uint64_t analysis_idle_ns					= 100000000;
+    CNST size_t pool_max_threads					= 8;
+    /* Jobs other threads can have queued at once, a power of two. Each
+     * source queues at most one, a full inbox makes submit() fail */
+    CNST size_t pool_inbox_size						= 256;
+    CNST uint64_t pool_stats_interval_ns			= 60000000000;
+    /* How often stage timings are logged with SPECTRALIZER_PROFILE */
+    CNST uint64_t profile_log_interval_ns			= 60000000000;
+    /* Ticks after an update until allocating is considered a bug, the
+     * published frames are only sized once each of the three is used */
+    CNST uint32_t alloc_warmup_ticks				= 8;
+}
+
+/* clang-format on */
@@ -0,0 +1,121 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "core.hpp"
+#include <atomic>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/* Values below 2^(HISTOGRAM_SUB_BITS + 1) ns get a bucket each, above that
+ * every power of two is split into 2^HISTOGRAM_SUB_BITS buckets, so a bucket
+ * is at most 1/8th of its value wide. Everything from 2^HISTOGRAM_MAX_BITS ns
+ * (~18 minutes) on ends up in the last bucket */
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_MAX_BITS 40
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS)
+
+namespace util {
+
+/* Lock free latency histogram with log-linear (hdr style) nanosecond
+ * buckets, precise enough for sub microsecond stages and long stalls alike */
+class histogram {
+	std::atomic<uint64_t> m_buckets[HISTOGRAM_BUCKETS];
+	std::atomic<uint64_t> m_count{0}, m_total_ns{0}, m_max_ns{0};
+
+	static size_t bucket_of(uint64_t ns)
+	{
+		if (ns < (2ull << HISTOGRAM_SUB_BITS))
+			return static_cast<size_t>(ns);
+		if (ns >= (1ull << HISTOGRAM_MAX_BITS))
+			return HISTOGRAM_BUCKETS - 1;
+
+#ifdef _MSC_VER
+		unsigned long msb;
+		_BitScanReverse64(&msb, ns);
+#else
+		unsigned msb = 63 - __builtin_clzll(ns);
+#endif
+		/* The top HISTOGRAM_SUB_BITS + 1 bits, of which the highest is always set */
+		auto shift = msb - HISTOGRAM_SUB_BITS;
+		return static_cast<size_t>((shift << HISTOGRAM_SUB_BITS) + (ns >> shift));
+	}
+
+	/* First value that's too large for the bucket */
+	static uint64_t bucket_end(size_t bucket)
+	{
+		if (bucket < (1u << HISTOGRAM_SUB_BITS))
+			return bucket + 1;
+		auto shift = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+		auto top = (1u << HISTOGRAM_SUB_BITS) + (bucket & ((1u << HISTOGRAM_SUB_BITS) - 1));
+		return static_cast<uint64_t>(top + 1) << shift;
+	}
+
+public:
+	histogram() { reset(); }
+
+	void add(uint64_t ns)
+	{
+		m_buckets[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		m_total_ns.fetch_add(ns, std::memory_order_relaxed);
+
+		uint64_t max = m_max_ns.load(std::memory_order_relaxed);
+		while (ns > max && !m_max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+			;
+	}
+
+	void reset()
+	{
+		for (auto &b : m_buckets)
+			b.store(0, std::memory_order_relaxed);
+		m_count = 0;
+		m_total_ns = 0;
+		m_max_ns = 0;
+	}
+
+	uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+	double mean_us() const { return count() ? m_total_ns / (count() * 1000.0) : 0.0; }
+	double max_us() const { return m_max_ns / 1000.0; }
+
+	/* Upper bound of the bucket the percentile falls into (or the max), in microseconds */
+	double percentile_us(double p) const
+	{
+		uint64_t target = static_cast<uint64_t>(count() * p), seen = 0;
+		for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+			seen += m_buckets[i].load(std::memory_order_relaxed);
+			if (seen > target)
+				return UTIL_MIN(bucket_end(i) / 1000.0, max_us());
+		}
+		return max_us();
+	}
+
+	void log(int level, const char *name) const
+	{
+		auto n = count();
+		if (!n)
+			return;
+		write_log(level, "%s: %llu samples, avg %.2f us, p50 < %.2f us, p99 < %.2f us, p999 < %.2f us, max %.2f us",
+				  name, static_cast<unsigned long long>(n), mean_us(), percentile_us(0.5), percentile_us(0.99),
+				  percentile_us(0.999), max_us());
+	}
+};
+
+}
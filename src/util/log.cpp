@@ -0,0 +1,48 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "core.hpp"
+#include <atomic>
+#include <cstdio>
+
+namespace util {
+
+static void stderr_sink(int level, const char *format, va_list args)
+{
+	if (level >= LL_DEBUG)
+		return;
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+}
+
+static std::atomic<log_sink> active_sink{stderr_sink};
+
+void set_log_sink(log_sink sink)
+{
+	active_sink = sink ? sink : stderr_sink;
+}
+
+void log(int level, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	active_sink.load()(level, format, args);
+	va_end(args);
+}
+
+}
@@ -0,0 +1,71 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "profiler.hpp"
+#include <chrono>
+#include <cstdio>
+
+namespace util {
+
+static const char *stage_names[PS_COUNT] = {"capture", "input",   "fft",     "binning",
+											"smoothing", "scaling", "falloff", "vertices"};
+
+const char *profile_stage_name(profile_stage stage)
+{
+	return stage < PS_COUNT ? stage_names[stage] : "unknown";
+}
+
+#ifdef SPECTRALIZER_PROFILE
+
+uint64_t profile_clock_ns()
+{
+	auto now = std::chrono::steady_clock::now().time_since_epoch();
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count());
+}
+
+void stage_profile::log(int level, const char *name) const
+{
+	char stage_name[128];
+	for (size_t i = 0; i < PS_COUNT; i++) {
+		snprintf(stage_name, sizeof(stage_name), "'%s' %s", name, profile_stage_name(profile_stage(i)));
+		m_stages[i].log(level, stage_name);
+	}
+}
+
+void stage_profile::log_periodically(const char *name)
+{
+	auto now = profile_clock_ns();
+	uint64_t next = m_next_log_ns;
+	if (!next) {
+		/* Start counting from the first call, not from boot */
+		m_next_log_ns.compare_exchange_strong(next, now + constants::profile_log_interval_ns);
+		return;
+	}
+	if (now >= next && m_next_log_ns.compare_exchange_strong(next, now + constants::profile_log_interval_ns))
+		log(LL_DEBUG, name);
+}
+
+void stage_profile::reset()
+{
+	for (auto &stage : m_stages)
+		stage.reset();
+}
+
+#endif
+
+}
@@ -0,0 +1,116 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "histogram.hpp"
+
+namespace util {
+
+/* Steps between captured audio and drawn bars, timed separately */
+enum profile_stage {
+	PS_CAPTURE,   /* Copying audio out of the source */
+	PS_INPUT,     /* Converting it into the fft input */
+	PS_FFT,       /* fft and magnitudes */
+	PS_BINNING,   /* Summing magnitudes into bars */
+	PS_SMOOTHING, /* Monstercat or sgs */
+	PS_SCALING,
+	PS_FALLOFF,
+	PS_VERTICES, /* Turning bars into what render() draws */
+	PS_COUNT
+};
+
+const char *profile_stage_name(profile_stage stage);
+
+#ifdef SPECTRALIZER_PROFILE
+
+uint64_t profile_clock_ns();
+
+/* Latencies of each stage for one visualizer. Analysis and render time
+ * their stages on different threads, which is fine since histograms are lock free */
+class stage_profile {
+	histogram m_stages[PS_COUNT];
+	std::atomic<uint64_t> m_next_log_ns{0};
+
+public:
+	void add(profile_stage stage, uint64_t ns) { m_stages[stage].add(ns); }
+	const histogram &stage(profile_stage stage) const { return m_stages[stage]; }
+
+	void log(int level, const char *name) const;
+	/* Logs at debug level every constants::profile_log_interval_ns */
+	void log_periodically(const char *name);
+	void reset();
+};
+
+/* Adds the time until it goes out of scope (or until lap()) to a stage,
+ * does nothing without a profile */
+class stage_timer {
+	stage_profile *m_profile;
+	profile_stage m_stage;
+	uint64_t m_start;
+
+public:
+	stage_timer(stage_profile *profile, profile_stage stage)
+		: m_profile(profile), m_stage(stage), m_start(profile ? profile_clock_ns() : 0)
+	{
+	}
+
+	~stage_timer() { stop(); }
+
+	stage_timer(const stage_timer &) = delete;
+	stage_timer &operator=(const stage_timer &) = delete;
+
+	/* Ends the current stage and starts timing the next one */
+	void lap(profile_stage next)
+	{
+		if (!m_profile)
+			return;
+		auto now = profile_clock_ns();
+		m_profile->add(m_stage, now - m_start);
+		m_stage = next;
+		m_start = now;
+	}
+
+	/* Ends the current stage early */
+	void stop()
+	{
+		if (m_profile)
+			m_profile->add(m_stage, profile_clock_ns() - m_start);
+		m_profile = nullptr;
+	}
+};
+
+#else
+
+/* Without SPECTRALIZER_PROFILE everything compiles down to nothing */
+class stage_profile {
+public:
+	void log(int, const char *) const {}
+	void log_periodically(const char *) {}
+	void reset() {}
+};
+
+class stage_timer {
+public:
+	stage_timer(stage_profile *, profile_stage) {}
+	void lap(profile_stage) {}
+	void stop() {}
+};
+
+#endif
+
+}
@@ -0,0 +1,165 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "core.hpp"
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace util {
+
+/* Keeps the rounding error of every add (Neumaier's variant of Kahan
+ * summation), so values that are added and later subtracted again
+ * cancel out instead of slowly drifting the sum */
+class compensated_sum {
+	double m_sum = 0.0, m_compensation = 0.0;
+
+public:
+	void add(double v)
+	{
+		const double t = m_sum + v;
+		if (std::abs(m_sum) >= std::abs(v))
+			m_compensation += (m_sum - t) + v;
+		else
+			m_compensation += (v - t) + m_sum;
+		m_sum = t;
+	}
+
+	void reset() { m_sum = m_compensation = 0.0; }
+	double value() const { return m_sum + m_compensation; }
+};
+
+/* Fixed capacity window over the newest values with running sums, so that
+ * mean and standard deviation cost O(1) per value. Also sums up the oldest
+ * head_size values, which auto scaling compares the whole window against */
+class rolling_stats {
+	std::vector<double> m_values;
+	size_t m_first = 0, m_size = 0, m_head_size = 0;
+	compensated_sum m_sum, m_squares, m_head_sum;
+
+	double at(size_t i) const
+	{
+		i += m_first;
+		return m_values[i < m_values.size() ? i : i - m_values.size()];
+	}
+
+	void pop_front()
+	{
+		const double v = at(0);
+		m_sum.add(-v);
+		m_squares.add(-v * v);
+		if (++m_first == m_values.size())
+			m_first = 0;
+		--m_size;
+
+		/* The head moves up by one value */
+		if (m_head_size) {
+			m_head_sum.add(-v);
+			if (m_size >= m_head_size)
+				m_head_sum.add(at(m_head_size - 1));
+		}
+	}
+
+public:
+	/* Drops all values */
+	void reset(size_t capacity, size_t head_size)
+	{
+		m_values.assign(capacity, 0.0);
+		m_head_size = head_size;
+		m_first = m_size = 0;
+		m_sum.reset();
+		m_squares.reset();
+		m_head_sum.reset();
+	}
+
+	/* Replaces the oldest value once full */
+	void push(double v)
+	{
+		if (m_values.empty())
+			return;
+		if (m_size == m_values.size())
+			pop_front();
+
+		auto i = m_first + m_size;
+		m_values[i < m_values.size() ? i : i - m_values.size()] = v;
+		m_sum.add(v);
+		m_squares.add(v * v);
+		if (m_size < m_head_size)
+			m_head_sum.add(v);
+		++m_size;
+	}
+
+	/* Drops the oldest count values and sums up the rest from scratch */
+	void drop_front(size_t count)
+	{
+		while (count-- && m_size)
+			pop_front();
+
+		m_sum.reset();
+		m_squares.reset();
+		m_head_sum.reset();
+		for (size_t i = 0; i < m_size; ++i) {
+			const double v = at(i);
+			m_sum.add(v);
+			m_squares.add(v * v);
+			if (i < m_head_size)
+				m_head_sum.add(v);
+		}
+	}
+
+	size_t size() const { return m_size; }
+	size_t capacity() const { return m_values.size(); }
+	size_t head_size() const { return m_head_size; }
+
+	double mean() const { return m_sum.value() / m_size; }
+	/* Population standard deviation, same as computing it over all values at once */
+	double std_dev() const { return std::sqrt((m_squares.value() / m_size) - std::pow(mean(), 2)); }
+	double head_sum() const { return m_head_sum.value(); }
+};
+
+/* Auto scaling's reset step, after current_max_height was pushed into values and
+ * moving_average and std_dev were taken from it. If the oldest values average out
+ * far from the whole window, most of the window is dropped and current_max_height
+ * is pushed again. True if the window was reset */
+inline bool maybe_reset_scaling_window(double current_max_height, size_t max_number_of_elements,
+									   rolling_stats *values, double *moving_average, double *std_dev)
+{
+	const auto reset_window_size = (constants::auto_scaling_reset_window * max_number_of_elements);
+	// Current max height is much larger than moving average, so throw away most
+	// values re-calculate
+	if (static_cast<double>(values->size()) <= reset_window_size)
+		return false;
+
+	// get average over scaling window, which is the oldest values
+	auto average_over_reset_window = values->head_sum() / reset_window_size;
+
+	// if short term average very different from long term moving average,
+	// reset window and re-calculate
+	if (std::abs(average_over_reset_window - *moving_average) <= (constants::deviation_amount_to_reset * (*std_dev)))
+		return false;
+
+	values->drop_front(
+		static_cast<size_t>(static_cast<double>(values->size()) * constants::auto_scaling_erase_percent));
+	values->push(current_max_height);
+	*moving_average = values->mean();
+	*std_dev = values->std_dev();
+	return true;
+}
+
+}
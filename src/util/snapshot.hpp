@@ -0,0 +1,143 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "core.hpp"
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+/* Holds the latest published version of an object. Readers never lock,
+ * each one owns a slot in which it announces the snapshot it's using
+ * (a hazard pointer), so that writers know which old versions are still
+ * alive. Every slot may only be used by one thread at a time.
+ * Use a const T for objects that are never modified after publishing */
+template<class T, size_t Readers> class snapshot_cell {
+	struct slot {
+		std::atomic<T *> ptr{nullptr};
+		char pad[CACHE_LINE_SIZE - sizeof(std::atomic<T *>)];
+	};
+
+	std::atomic<T *> m_current{nullptr};
+	char m_pad[CACHE_LINE_SIZE - sizeof(std::atomic<T *>)];
+	slot m_slots[Readers];
+	std::mutex m_writer_mutex; /* Writers only ever block other writers */
+	std::vector<T *> m_retired;
+
+	bool in_use(T *ptr) const
+	{
+		for (auto &s : m_slots) {
+			if (s.ptr.load() == ptr)
+				return true;
+		}
+		return false;
+	}
+
+	T *acquire(size_t reader)
+	{
+		T *ptr = m_current.load();
+		for (;;) {
+			m_slots[reader].ptr.store(ptr);
+			/* The writer might have retired it before we announced it */
+			T *check = m_current.load();
+			if (check == ptr)
+				return ptr;
+			ptr = check;
+		}
+	}
+
+	void release(size_t reader) { m_slots[reader].ptr.store(nullptr, std::memory_order_release); }
+
+	void collect_locked()
+	{
+		for (auto it = m_retired.begin(); it != m_retired.end();) {
+			if (!*it || !in_use(*it)) {
+				delete *it;
+				it = m_retired.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+
+public:
+	snapshot_cell() = default;
+	snapshot_cell(const snapshot_cell &) = delete;
+	snapshot_cell &operator=(const snapshot_cell &) = delete;
+
+	~snapshot_cell()
+	{
+		for (auto *ptr : m_retired)
+			delete ptr;
+		delete m_current.load();
+	}
+
+	/* Takes ownership of next, the previous version is deleted
+	 * once no reader holds it anymore */
+	void publish(T *next)
+	{
+		std::lock_guard<std::mutex> lock(m_writer_mutex);
+		m_retired.emplace_back(m_current.exchange(next));
+		collect_locked();
+	}
+
+	/* Retries deleting versions that were still in use when they were replaced */
+	void collect()
+	{
+		std::lock_guard<std::mutex> lock(m_writer_mutex);
+		collect_locked();
+	}
+
+	/* Waits until no reader holds a replaced version anymore */
+	void synchronize()
+	{
+		for (;;) {
+			{
+				std::lock_guard<std::mutex> lock(m_writer_mutex);
+				collect_locked();
+				if (m_retired.empty())
+					return;
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	/* Keeps the current snapshot alive for its lifetime */
+	class reader {
+		snapshot_cell *m_cell;
+		size_t m_slot;
+		T *m_ptr;
+
+	public:
+		reader(snapshot_cell &cell, size_t slot) : m_cell(&cell), m_slot(slot) { m_ptr = cell.acquire(slot); }
+		~reader() { m_cell->release(m_slot); }
+		reader(const reader &) = delete;
+		reader &operator=(const reader &) = delete;
+
+		T *get() const { return m_ptr; }
+		T *operator->() const { return m_ptr; }
+		T &operator*() const { return *m_ptr; }
+		explicit operator bool() const { return m_ptr != nullptr; }
+	};
+};
+
+}
@@ -0,0 +1,249 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#include "thread_pool.hpp"
+#include "util.hpp"
+#include <util/platform.h>
+#include <util/threading.h>
+
+namespace util {
+
+static const char *job_names[JOB_COUNT] = { "analysis" };
+
+/* Index of the worker's own queue, or -1 on other threads */
+static thread_local int worker_index = -1;
+
+thread_pool::thread_pool(size_t threads)
+{
+	os_sem_init(&m_wake, 0);
+	m_inbox.reset(new inbox_slot[constants::pool_inbox_size]);
+	for (size_t i = 0; i < constants::pool_inbox_size; i++)
+		m_inbox[i].sequence = i;
+
+	for (size_t i = 0; i < threads; i++)
+		m_queues.emplace_back(new queue);
+	for (size_t i = 0; i < threads; i++)
+		m_workers.emplace_back(&thread_pool::run, this, i);
+	m_next_stats_ns = os_gettime_ns() + constants::pool_stats_interval_ns;
+}
+
+thread_pool::~thread_pool()
+{
+	m_running = false;
+	for (size_t i = 0; i < m_workers.size(); i++)
+		os_sem_post(m_wake);
+
+	for (auto &worker : m_workers)
+		worker.join();
+	os_sem_destroy(m_wake);
+}
+
+void thread_pool::queue::push_back(job &&j)
+{
+	if (count == jobs.size()) {
+		std::vector<job> grown(jobs.size() * 2);
+		for (size_t i = 0; i < count; i++)
+			grown[i] = std::move(jobs[(first + i) % jobs.size()]);
+		jobs.swap(grown);
+		first = 0;
+	}
+	jobs[(first + count++) % jobs.size()] = std::move(j);
+}
+
+bool thread_pool::queue::pop_back(job *out)
+{
+	if (!count)
+		return false;
+	*out = std::move(jobs[(first + --count) % jobs.size()]);
+	return true;
+}
+
+bool thread_pool::queue::pop_front(job *out)
+{
+	if (!count)
+		return false;
+	*out = std::move(jobs[first]);
+	first = (first + 1) % jobs.size();
+	--count;
+	return true;
+}
+
+bool thread_pool::push_inbox(job &&j)
+{
+	const size_t mask = constants::pool_inbox_size - 1;
+	size_t pos = m_inbox_tail.load(std::memory_order_relaxed);
+
+	for (;;) {
+		auto &slot = m_inbox[pos & mask];
+		size_t sequence = slot.sequence.load(std::memory_order_acquire);
+		auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+		if (diff == 0) {
+			if (m_inbox_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				slot.j = std::move(j);
+				slot.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (diff < 0) {
+			return false; /* Full */
+		} else {
+			pos = m_inbox_tail.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool thread_pool::pop_inbox(job *out)
+{
+	const size_t mask = constants::pool_inbox_size - 1;
+	size_t pos = m_inbox_head.load(std::memory_order_relaxed);
+
+	for (;;) {
+		auto &slot = m_inbox[pos & mask];
+		size_t sequence = slot.sequence.load(std::memory_order_acquire);
+		auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+		if (diff == 0) {
+			if (m_inbox_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				*out = std::move(slot.j);
+				slot.sequence.store(pos + mask + 1, std::memory_order_release);
+				return true;
+			}
+		} else if (diff < 0) {
+			return false; /* Empty, or the oldest push isn't done yet */
+		} else {
+			pos = m_inbox_head.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool thread_pool::submit(job_kind kind, std::function<void()> fn)
+{
+	if (worker_index >= 0) {
+		auto &own = *m_queues[worker_index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		own.push_back({kind, os_gettime_ns(), std::move(fn)});
+	} else if (!push_inbox({kind, os_gettime_ns(), std::move(fn)})) {
+		return false;
+	}
+
+	/* The job is visible before the post, so whoever takes it finds one */
+	os_sem_post(m_wake);
+	return true;
+}
+
+bool thread_pool::pop(size_t index, job *out)
+{
+	/* Newest job from our own queue first, it's likely still in cache */
+	{
+		auto &own = *m_queues[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (own.pop_back(out))
+			return true;
+	}
+
+	if (pop_inbox(out))
+		return true;
+
+	/* Then steal the oldest job from someone else */
+	for (size_t i = 1; i < m_queues.size(); i++) {
+		auto &other = *m_queues[(index + i) % m_queues.size()];
+		std::lock_guard<std::mutex> lock(other.mutex);
+		if (other.pop_front(out)) {
+			++m_steals;
+			return true;
+		}
+	}
+	return false;
+}
+
+void thread_pool::run(size_t index)
+{
+	worker_index = static_cast<int>(index);
+	os_set_thread_name("spectralizer: worker");
+
+	for (;;) {
+		os_sem_wait(m_wake);
+
+		/* Every post stands for one job that pop() can see, if another worker
+		 * takes ours it leaves its own. Only an earlier push into the inbox
+		 * that isn't done yet can hide it, for a few instructions.
+		 * Without a job the post came from the destructor */
+		job j;
+		bool found;
+		while (!(found = pop(index, &j)) && m_running)
+			std::this_thread::yield();
+		if (!found)
+			break;
+
+		uint64_t start = os_gettime_ns();
+		j.fn();
+		uint64_t end = os_gettime_ns();
+
+		m_wait[j.kind].add(start - j.queued_ns);
+		m_run[j.kind].add(end - start);
+
+		uint64_t next = m_next_stats_ns;
+		if (end >= next && m_next_stats_ns.compare_exchange_strong(next, end + constants::pool_stats_interval_ns))
+			log_stats(LOG_DEBUG);
+	}
+}
+
+void thread_pool::log_stats(int level)
+{
+	blog(level, "[spectralizer] Thread pool: %zu workers, %llu jobs stolen", m_workers.size(),
+		 static_cast<unsigned long long>(m_steals.load()));
+
+	char name[64];
+	for (size_t i = 0; i < JOB_COUNT; i++) {
+		snprintf(name, sizeof(name), "%s job wait", job_names[i]);
+		m_wait[i].log(level, name);
+		snprintf(name, sizeof(name), "%s job run", job_names[i]);
+		m_run[i].log(level, name);
+	}
+}
+
+namespace pool {
+
+static thread_pool *shared_pool = nullptr;
+
+void start()
+{
+	size_t cores = std::thread::hardware_concurrency();
+	/* Leave a core for obs' own threads */
+	size_t threads = UTIL_CLAMP(size_t(1), cores > 1 ? cores - 1 : 1, constants::pool_max_threads);
+	shared_pool = new thread_pool(threads);
+	info("Started thread pool with %zu workers", threads);
+}
+
+void stop()
+{
+	if (shared_pool) {
+		shared_pool->log_stats(LOG_INFO);
+		delete shared_pool;
+		shared_pool = nullptr;
+	}
+}
+
+thread_pool *get()
+{
+	return shared_pool;
+}
+
+}
+
+}
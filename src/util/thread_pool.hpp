@@ -0,0 +1,98 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "histogram.hpp"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <util/threading.h>
+#include <vector>
+
+namespace util {
+
+/* Kinds of jobs, each one gets its own latency histograms */
+enum job_kind { JOB_ANALYSIS, JOB_COUNT };
+
+/* Work stealing thread pool shared by all sources. Every worker has its
+ * own queue, jobs submitted from a worker stay on its queue. Other threads
+ * submit through a lock-free inbox, so the audio thread never waits.
+ * Idle workers sleep on a semaphore and steal from other queues */
+class thread_pool {
+	struct job {
+		job_kind kind;
+		uint64_t queued_ns;
+		std::function<void()> fn;
+	};
+
+	/* Ring of jobs that grows when full but never shrinks, so unlike
+	 * a deque it doesn't allocate and free blocks as jobs come and go */
+	struct queue {
+		std::mutex mutex;
+		std::vector<job> jobs = std::vector<job>(16);
+		size_t first = 0, count = 0;
+
+		void push_back(job &&j);
+		bool pop_back(job *out);
+		bool pop_front(job *out);
+	};
+
+	/* Bounded multi producer, multi consumer queue (Vyukov), the sequence
+	 * of each slot tells producers and consumers whose turn it is */
+	struct inbox_slot {
+		std::atomic<size_t> sequence{0};
+		job j;
+	};
+
+	std::vector<std::unique_ptr<queue>> m_queues;
+	std::unique_ptr<inbox_slot[]> m_inbox;
+	std::atomic<size_t> m_inbox_head{0}, m_inbox_tail{0};
+	std::vector<std::thread> m_workers;
+	std::atomic<bool> m_running{true};
+	std::atomic<uint64_t> m_steals{0}, m_next_stats_ns{0};
+	os_sem_t *m_wake = nullptr; /* Posted once per job and once per worker on shutdown */
+
+	/* Time from submitting to starting and time spent running */
+	histogram m_wait[JOB_COUNT], m_run[JOB_COUNT];
+
+	bool push_inbox(job &&j);
+	bool pop_inbox(job *out);
+	bool pop(size_t index, job *out);
+	void run(size_t index);
+
+public:
+	explicit thread_pool(size_t threads);
+	~thread_pool(); /* Finishes queued jobs */
+
+	/* Safe to call from any thread, including the audio thread, which
+	 * never takes a lock. False if the inbox is full */
+	bool submit(job_kind kind, std::function<void()> fn);
+
+	size_t threads() const { return m_workers.size(); }
+	void log_stats(int level);
+};
+
+namespace pool {
+void start();
+void stop();
+thread_pool *get();
+}
+
+}
@@ -0,0 +1,59 @@
+/*************************************************************************
+ * This file is part of spectralizer
+ * github.con/univrsal/spectralizer
+ * Copyright 2020 univrsal <universailp@web.de>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *************************************************************************/
+
+#pragma once
+#include "util.hpp"
+#include <atomic>
+#include <cstdint>
+
+namespace util {
+
+/* Hands the newest value from one writer thread to one reader thread
+ * without either of them waiting. The writer fills back() and publishes it,
+ * the reader swaps in whatever was published last. Values that are
+ * published faster than they're read are skipped */
+template<class T> class triple_buffer {
+	static constexpr uint8_t fresh = 0x4; /* Set while the middle holds an unread value */
+	static constexpr uint8_t index = 0x3;
+
+	T m_buffers[3];
+	std::atomic<uint8_t> m_middle{1};
+	char m_pad0[CACHE_LINE_SIZE - sizeof(std::atomic<uint8_t>)];
+	uint8_t m_back = 0; /* Writer only */
+	char m_pad1[CACHE_LINE_SIZE - sizeof(uint8_t)];
+	uint8_t m_front = 2; /* Reader only */
+
+public:
+	/* Writer */
+	T &back() { return m_buffers[m_back]; }
+
+	void publish() { m_back = m_middle.exchange(m_back | fresh, std::memory_order_acq_rel) & index; }
+
+	/* Reader: swaps in the last published value, returns false if there wasn't a new one */
+	bool acquire()
+	{
+		if (!(m_middle.load(std::memory_order_relaxed) & fresh))
+			return false;
+		m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & index;
+		return true;
+	}
+
+	const T &front() const { return m_buffers[m_front]; }
+};
+
+}
@@ -19,24 +19,14 @@
 #pragma once
 
 #include <obs-module.h>
-#include <vector>
+#include "core.hpp"
 
 /* Logging */
 #define log_src(log_level, format, ...) \
 	blog(log_level, "[spectralizer: '%s'] " format, obs_source_get_name(context->source), ##__VA_ARGS__)
-#define write_log(log_level, format, ...) blog(log_level, "[spectralizer] " format, ##__VA_ARGS__)
-
-#define debug(format, ...) write_log(LOG_DEBUG, format, ##__VA_ARGS__)
-#define info(format, ...) write_log(LOG_INFO, format, ##__VA_ARGS__)
-#define warn(format, ...) write_log(LOG_WARNING, format, ##__VA_ARGS__)
 
 /* clang-format off */
 
-#define UTIL_EULER 2.7182818284590452353
-#define UTIL_SWAP(a, b) do { typeof(a) tmp = a; a = b; b = tmp; } while (0)
-#define UTIL_MAX(a, b)                  (((a) > (b)) ? (a) : (b))
-#define UTIL_MIN(a, b)                  (((a) < (b)) ? (a) : (b))
-#define UTIL_CLAMP(lower, x, upper) 	(UTIL_MIN(upper, UTIL_MAX(x, lower)))
 #define T_(v)                           obs_module_text(v)
 
 #define T_SOURCE                        T_("Spectralizer.Source")
@@ -51,6 +41,8 @@
 #define T_AUDIO_SOURCE_NONE             T_("Spectralizer.AudioSource.None")
 #define T_SOURCE_MPD                    T_("Spectralizer.Source.Fifo")
 #define T_FIFO_PATH                     T_("Spectralizer.Source.Fifo.Path")
+#define T_SOURCE_REPLAY                 T_("Spectralizer.Source.Replay")
+#define T_REPLAY_PATH                   T_("Spectralizer.Source.Replay.Path")
 #define T_BAR_WIDTH                     T_("Spectralizer.Bar.Width")
 #define T_BAR_HEIGHT                    T_("Spectralizer.Bar.Height")
 #define T_SAMPLE_RATE                   T_("Spectralizer.SampleRate")
@@ -77,6 +69,12 @@
 #define T_WIRE_MODE_FILL_INVERTED		T_("Spectralizer.Wire.Mode.Fill.Invert")
 #define T_WIRE_MODE						T_("Spectralizer.Wire.Mode")
 #define T_WIRE_THICKNESS				T_("Spectralizer.Wire.Thickness")
+#define T_STEREO_PACKED					T_("Spectralizer.Stereo.Packed")
+#define T_FFT_RIGOR						T_("Spectralizer.FFT.Rigor")
+#define T_FFT_RIGOR_ESTIMATE			T_("Spectralizer.FFT.Rigor.Estimate")
+#define T_FFT_RIGOR_MEASURE				T_("Spectralizer.FFT.Rigor.Measure")
+#define T_FFT_RIGOR_PATIENT				T_("Spectralizer.FFT.Rigor.Patient")
+#define T_ANALYSIS_THREAD				T_("Spectralizer.AnalysisThread")
 
 #define S_SOURCE_MODE                   "source_mode"
 #define S_STEREO                        "stereo"
@@ -85,6 +83,7 @@
 #define S_REFRESH_RATE                  "refresh_rate"
 #define S_AUDIO_SOURCE                  "audio_source"
 #define S_FIFO_PATH                     "fifo_path"
+#define S_REPLAY_PATH                   "replay_path"
 #define S_BAR_WIDTH                     "width"
 #define S_BAR_HEIGHT                    "height"
 #define S_SAMPLE_RATE                   "sample_rate"
@@ -102,92 +101,8 @@
 #define S_SCALE_SIZE					"scale_size"
 #define S_WIRE_MODE						"wire_mode"
 #define S_WIRE_THICKNESS				"wire_thickness"
-
-enum visual_mode
-{
-    VM_BARS, VM_WIRE
-};
-
-enum wire_mode
-{
-    WM_THIN, WM_THICK, WM_FILL, WM_FILL_INVERTED
-};
-
-enum smooting_mode
-{
-    SM_NONE = 0,
-    SM_MONSTERCAT,
-    SM_SGS
-};
-
-enum falloff
-{
-    FO_NONE = 0,
-    FO_FILL,
-    FO_TOP
-};
-
-enum channel_mode
-{
-    CM_LEFT = 0,
-    CM_RIGHT,
-    CM_BOTH
-};
-
-struct stereo_sample_frame
-{
-    int16_t l, r;
-};
-
-using pcm_stereo_sample = struct stereo_sample_frame;
-#define CNST			static const constexpr
-
-namespace defaults {
-    CNST bool			stereo			= false;
-    CNST visual_mode 	visual			= VM_BARS;
-    CNST smooting_mode	smoothing		= SM_NONE;
-    CNST uint32_t		color			= 0xffffffff;
-
-    CNST uint16_t		detail			= 32,
-                        cx				= 50,
-                        cy				= 50,
-                        fps				= 30;
-
-    CNST uint32_t		sample_rate		= 44100,
-                        sample_size 	= sample_rate / fps;
-
-    CNST double			lfreq_cut		= 30,
-                        hfreq_cut		= 22050,
-                        falloff_weight	= .95,
-                        gravity			= .8;
-    CNST uint32_t		sgs_points		= 3,		/* Should be a odd number */
-                        sgs_passes		= 2;
-
-    CNST double			mcat_smooth		= 1.5;
-
-    CNST uint16_t		bar_space		= 2,
-                        bar_width		= 5,
-                        bar_height		= 100,
-                        bar_min_height	= 5;
-
-    CNST uint16_t		wire_thickness	= 5;
-    CNST wire_mode		wire_mode		= WM_THIN;
-
-    CNST char			*fifo_path		= "/tmp/mpd.fifo";
-    CNST char			*audio_source	= "none";
-
-    CNST bool			use_auto_scale	= true;
-    CNST double			scale_boost		= 0.0;
-    CNST double			scale_size		= 1.0;
-};
-
-namespace constants {
-    CNST int auto_scale_span 						= 30;
-    CNST double auto_scaling_reset_window			= 0.1;
-    CNST double auto_scaling_erase_percent 			= 0.75;
-    /* Amount of deviation needed between short term and long
-     * term moving max height averages to trigger an autoscaling reset */
-    CNST double deviation_amount_to_reset 			= 1.0;
-}
+#define S_STEREO_PACKED					"stereo_packed"
+#define S_FFT_RIGOR						"fft_rigor"
+#define S_ANALYSIS_THREAD				"analysis_thread"
 
 /* clang-format on */